@@ -0,0 +1,214 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#include "bench/mock.hpp"
+#include "pie/device.hpp"
+#include "src/packets.hpp"
+#include "src/remote.hpp"
+
+#include <asio.hpp>
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <osc++.hpp>
+#include <string>
+
+namespace fs = std::filesystem;
+
+////////////////////////////////////////////////////////////////////////////////
+namespace
+{
+
+constexpr pie::byte columns = 16, rows = 8; // XKE-128
+
+// run the state machine until n more reports have been processed
+void process(asio::io_context& io, bench::mock& mock, std::size_t n)
+{
+    auto end = mock.reads() + n;
+    while(mock.reads() < end) io.run_one();
+}
+
+template<typename Fn>
+void run_device(benchmark::State& state, Fn&& setup)
+{
+    asio::io_context io;
+    auto tp = std::make_unique<bench::mock>(io, columns, rows);
+    auto& mock = *tp;
+
+    pie::device device{ std::move(tp) };
+    setup(device, mock);
+
+    std::size_t events = 0;
+    device.on_press([&](const pie::event&) { ++events; });
+    device.on_release([&](const pie::event&) { ++events; });
+
+    for(auto _ : state) process(io, mock, 1);
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["events"] = benchmark::Counter(events, benchmark::Counter::kIsRate);
+}
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void decode_buttons(benchmark::State& state)
+{
+    // dense reports, where every button changes state each time
+    run_device(state, [](pie::device&, bench::mock& mock)
+    {
+        pie::recv data{ };
+        auto gd = data.as<pie::general_data>();
+
+        for(auto& b : gd->buttons) b = 0x55;
+        mock.raw(data);
+
+        for(auto& b : gd->buttons) b = 0xaa;
+        mock.raw(data);
+    });
+}
+BENCHMARK(decode_buttons);
+
+////////////////////////////////////////////////////////////////////////////////
+void single_presses(benchmark::State& state)
+{
+    run_device(state, [](pie::device&, bench::mock& mock)
+    {
+        for(pie::index idx = 0; idx < columns * rows; ++idx)
+        {
+            mock.add({ idx });
+            mock.add({ });
+        }
+    });
+}
+BENCHMARK(single_presses);
+
+////////////////////////////////////////////////////////////////////////////////
+void chords(benchmark::State& state)
+{
+    run_device(state, [](pie::device&, bench::mock& mock)
+    {
+        mock.add({ 0, 9, 18, 27, 36, 45, 54, 63 });
+        mock.add({ });
+        mock.add({ 64, 73, 82, 91, 100, 109, 118, 127 });
+        mock.add({ });
+    });
+}
+BENCHMARK(chords);
+
+////////////////////////////////////////////////////////////////////////////////
+void group_churn(benchmark::State& state)
+{
+    run_device(state, [](pie::device& device, bench::mock& mock)
+    {
+        for(pie::index idx = 0; idx < columns * rows; ++idx)
+        {
+            device.set_group(idx, idx / 32);
+            mock.add({ idx });
+            mock.add({ });
+        }
+    });
+}
+BENCHMARK(group_churn);
+
+////////////////////////////////////////////////////////////////////////////////
+void lock_mode(benchmark::State& state)
+{
+    run_device(state, [](pie::device& device, bench::mock& mock)
+    {
+        for(pie::index idx = 0; idx < columns * rows; ++idx) device.set_toggle(idx);
+
+        for(pie::index idx = 0; idx < 32; ++idx)
+        {
+            mock.add({ idx });
+            mock.add({ });
+        }
+
+        // lock, press some buttons and unlock
+        mock.add({ }, true);
+        mock.add({ });
+        for(pie::index idx = 32; idx < 64; ++idx)
+        {
+            mock.add({ idx });
+            mock.add({ });
+        }
+        mock.add({ }, true);
+        mock.add({ });
+    });
+}
+BENCHMARK(lock_mode);
+
+////////////////////////////////////////////////////////////////////////////////
+void osc_message(benchmark::State& state)
+{
+    pie::byte uid = 42;
+    pie::index idx = 0;
+    auto prefix = "/remote/pie/" + std::to_string(uid) + "/";
+
+    for(auto _ : state)
+    {
+        osc::message msg{ prefix + std::to_string(idx) + "/press" };
+        msg << uid << idx << "press";
+
+        auto packet = msg.to_packet();
+        benchmark::DoNotOptimize(packet);
+
+        ++idx;
+    }
+}
+BENCHMARK(osc_message);
+
+////////////////////////////////////////////////////////////////////////////////
+void osc_packets(benchmark::State& state)
+{
+    src::packets packets{ 42 };
+    pie::index idx = 0;
+
+    for(auto _ : state)
+    {
+        auto buf = packets.press(idx++);
+        benchmark::DoNotOptimize(buf);
+    }
+}
+BENCHMARK(osc_packets);
+
+////////////////////////////////////////////////////////////////////////////////
+void osc_packets_rebuild(benchmark::State& state)
+{
+    src::packets packets;
+    for(auto _ : state) packets.rebuild(42);
+}
+BENCHMARK(osc_packets_rebuild);
+
+////////////////////////////////////////////////////////////////////////////////
+void conf_from(benchmark::State& state)
+{
+    auto path = fs::temp_directory_path() / "baker-bench.conf";
+    {
+        std::ofstream fs{ path };
+        for(int n = 0; n < state.range(0); ++n)
+        {
+            fs << "# line " << n << "\n";
+            fs << "double-press = 0 1 2 3 4 5 6 7\n";
+            fs << "toggle = 8 9 10 11 12 13 14 15\n";
+            fs << "group " << n % pie::layout::max_groups << " = 16 17 18 19 20 21 22 23 24 25 26 27 28 29 30 31\n";
+        }
+    }
+
+    asio::io_context io;
+    src::remote remote{ path, std::make_unique<bench::mock>(io, columns, rows) };
+
+    for(auto _ : state) remote.conf_from(path);
+
+    state.SetItemsProcessed(state.iterations() * state.range(0) * 4);
+    fs::remove(path);
+}
+BENCHMARK(conf_from)->Arg(100)->Arg(10000);
+
+////////////////////////////////////////////////////////////////////////////////
+BENCHMARK_MAIN();
@@ -0,0 +1,93 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#ifndef BENCH_MOCK_HPP
+#define BENCH_MOCK_HPP
+
+////////////////////////////////////////////////////////////////////////////////
+#include "pie/transport.hpp"
+#include "pie/types.hpp"
+
+#include <asio.hpp>
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace bench
+{
+
+////////////////////////////////////////////////////////////////////////////////
+// Mock transport, which returns a descriptor of a keypad with the given
+// geometry and then cycles through a list of synthetic reports.
+//
+class mock : public pie::transport
+{
+public:
+    mock(asio::io_context& io, pie::byte columns, pie::byte rows) : transport{ io }
+    {
+        descriptor_.fill(0);
+        auto dd = descriptor_.as<pie::descriptor_data>();
+        dd->columns = columns;
+        dd->rows = rows;
+    }
+
+    // add report with the given buttons pressed
+    void add(std::initializer_list<pie::index> pressed, bool ps = false)
+    {
+        pie::recv data{ };
+        auto gd = data.as<pie::general_data>();
+        gd->ps = ps;
+        for(auto idx : pressed) gd->buttons[idx / 8] |= 1 << (idx % 8);
+
+        reports_.push_back(data);
+    }
+
+    // add raw report (eg, one taken from a recording)
+    void raw(const pie::recv& data) { reports_.push_back(data); }
+
+    auto reads() const { return reads_; }
+
+    void async_read(asio::mutable_buffer buf, pie::io_handler cb) override
+    {
+        asio::post(io(), [=]{ cb({ }, next(buf)); });
+    }
+    void async_write(const pie::buffers& bufs, pie::io_handler cb) override
+    {
+        asio::post(io(), [=]{ cb({ }, asio::buffer_size(bufs)); });
+    }
+
+    std::size_t read(asio::mutable_buffer buf) override
+    {
+        std::memcpy(buf.data(), descriptor_.data(), descriptor_.size());
+        return descriptor_.size();
+    }
+    void write(asio::const_buffer) override { }
+
+    bool is_open() const override { return true; }
+    void close() override { }
+
+private:
+    pie::recv descriptor_;
+    std::vector<pie::recv> reports_;
+    std::size_t reads_ = 0;
+
+    std::size_t next(asio::mutable_buffer buf)
+    {
+        if(reports_.empty()) reports_.emplace_back();
+
+        auto& data = reports_[reads_++ % reports_.size()];
+        std::memcpy(buf.data(), data.data(), data.size());
+        return data.size();
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -6,77 +6,214 @@
 
 ////////////////////////////////////////////////////////////////////////////////
 #include "device.hpp"
+#include "latency.hpp"
+#include "metrics.hpp"
 
-#include <cerrno>
+#include <algorithm>
 #include <climits> // CHAR_BIT
+#include <cstdint>
+#include <iterator>
 #include <stdexcept>
-#include <system_error>
-
-#include <fcntl.h> // open
 
 ////////////////////////////////////////////////////////////////////////////////
 namespace pie
 {
 
 ////////////////////////////////////////////////////////////////////////////////
-device::device(asio::io_context& io, const fs::path& path) :
-    fd_{ io }
+namespace
 {
-    auto fd = ::open(path.c_str(), O_RDWR);
-    if(fd == -1) throw std::system_error{
-        std::error_code{ errno, std::generic_category() }
-    };
-    fd_.assign(fd);
 
-    request_descriptor(fd_);
+// wait for descriptor and resend the request this many times
+constexpr std::chrono::milliseconds descriptor_timeout{ 500 };
+constexpr int descriptor_retries = 3;
+
+constexpr byte descriptor_cmd = 214;
+
+// byte offsets of jog & shuttle data in general_data report by product id
+struct jog_shuttle_model { word pid; std::size_t jog, shuttle; };
+constexpr jog_shuttle_model jog_shuttle_models[] =
+{
+    { 0x0426,  6,  7 }, { 0x0428,  6,  7 }, // XK-12 Jog & Shuttle
+    { 0x045a, 18, 19 }, { 0x045c, 18, 19 }, // XK-68 Jog & Shuttle
+};
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+device::device(asio::io_context& io, const fs::path& path, init mode) :
+    device{ std::make_unique<hidraw>(io, path), mode }
+{ }
+
+////////////////////////////////////////////////////////////////////////////////
+device::device(std::unique_ptr<transport> tp, init mode) :
+    tp_{ std::move(tp) }
+{
+    request_descriptor(out_);
+    if(mode == async)
+    {
+        // request is written once the event loop runs
+        sched_descriptor();
+        sched_retry();
+        return;
+    }
+    out_.sync();
 
     recv data;
-    auto n = fd_.read_some(asio::buffer(data));
+    auto n = tp_->read(asio::buffer(data));
     if(n < sizeof(descriptor_data)) throw std::runtime_error{
         "Short read - descriptor_data"
     };
+    describe(data);
+
+    if(mode == sync) setup();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void device::sched_descriptor()
+{
+    tp_->async_read(asio::buffer(data_), [this](const asio::error_code& ec, std::size_t n){ read_descriptor(ec, n); });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void device::read_descriptor(const asio::error_code& ec, std::size_t n)
+{
+    if(ec == asio::error::operation_aborted) return;
+    if(ec) return init_done(ec);
+
+    // skip data reports that arrive before the descriptor
+    if(n < sizeof(descriptor_data) || data_.as<descriptor_data>()->cmd != descriptor_cmd) return sched_descriptor();
+
+    init_timer_.cancel();
+    describe(data_);
+    setup();
+
+    init_done({ });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void device::sched_retry()
+{
+    init_timer_.expires_after(descriptor_timeout);
+    init_timer_.async_wait([this](const asio::error_code& ec)
+    {
+        if(ec) return;
+
+        if(retries_++ < descriptor_retries)
+        {
+            request_descriptor(out_);
+            sched_retry();
+        }
+        else
+        {
+            tp_->close();
+            init_done(asio::error::timed_out);
+        }
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void device::init_done(const asio::error_code& ec)
+{
+    init_timer_.cancel();
+    if(ycall_) ycall_(ec);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void device::on_ready(ready_callback cb)
+{
+    ycall_ = std::move(cb);
+    if(ready_ && ycall_) ycall_({ });
+}
 
+////////////////////////////////////////////////////////////////////////////////
+void device::describe(const recv& data)
+{
     auto dd = data.as<descriptor_data>();
     uid_ = dd->uid;
     columns_ = dd->columns;
     rows_ = dd->rows;
-    buttons_.resize(columns_ * CHAR_BIT);
 
-    leds_on(fd_, leds::none);
+    for(auto& model : jog_shuttle_models)
+        if(model.pid == dd->pid) js_ = { model.jog, model.shuttle };
+    layout_ = pie::layout(columns_ * CHAR_BIT);
+
+    // valid button bits for this keypad + PS
+    byte mask[sizeof(general_data::buttons)]{ };
+    for(std::size_t col = 0; col < columns_ && col < std::size(mask); ++col)
+        mask[col] = (1 << rows_) - 1;
 
-    light_on(fd_, light::bank_1, all_rows);
-    light_on(fd_, light::bank_2, no_rows);
+    mask_ = indices::from(mask, std::size(mask));
+    mask_.insert(ps);
+}
 
-    level(fd_, 255, 255);
-    period(fd_, 10);
+////////////////////////////////////////////////////////////////////////////////
+void device::setup()
+{
+    // commands are merged into one batch write by the queue
+    leds_on(out_, leds::none);
 
-    request_data(fd_);
+    light_on(out_, light::bank_1, all_rows);
+    light_on(out_, light::bank_2, no_rows);
+
+    level(out_, 255, 255);
+    period(out_, 10);
+
+    request_data(out_);
     sched_read();
+
+    ready_ = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+device::~device() { cancel_timers(); }
+
+////////////////////////////////////////////////////////////////////////////////
+void device::close()
+{
+    cancel_timers();
+    jog_timer_.cancel();
+    init_timer_.cancel();
+    tp_->close();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void device::set_uid(byte new_uid)
 {
-    pie::uid(fd_, new_uid);
+    pie::uid(out_, new_uid);
+    out_.sync();
     uid_ = new_uid;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void device::sched_read()
 {
-    using namespace std::placeholders;
-    fd_.async_read_some(asio::buffer(data_), std::bind(&device::read_data, this, _1, _2));
+    tp_->async_read(asio::buffer(data_), [this](const asio::error_code& ec, std::size_t n){ read_data(ec, n); });
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void device::read_data(const asio::error_code& ec, std::size_t n)
 {
     if(ec) return;
+    time_ = tp_->read_time();
+
+    ++metrics().reports;
+    if(n < sizeof(general_data))
+    {
+        // skip malformed report rather than bring down the whole process
+        ++metrics().short_reads;
+        sched_read();
+        return;
+    }
+
+    // late or duplicate reply to a (resent) descriptor request
+    if(n >= sizeof(descriptor_data) && data_.as<descriptor_data>()->cmd == descriptor_cmd)
+    {
+        sched_read();
+        return;
+    }
 
-    if(n < sizeof(general_data)) throw std::runtime_error{
-        "Short read - general_data"
-    };
     auto [ pressed, released ] = decode_buttons();
+    latency().decode.record(since(time_.mono));
 
     // handle PS separately as it's not part of buttons_
     if(pressed.count(ps))
@@ -84,7 +221,7 @@ void device::read_data(const asio::error_code& ec, std::size_t n)
         if(pressed_once_ != none)
         {
             un_blink(pressed_once_);
-            pressed_once_ = none;
+            once(none);
         }
         press(ps);
         pressed.erase(ps);
@@ -99,131 +236,343 @@ void device::read_data(const asio::error_code& ec, std::size_t n)
 
     if(!locked_) for(auto idx : pressed)
     {
-        auto& btn = buttons_[idx];
-        if(btn.double_press)
+        arm(idx);
+
+        auto grp = layout_.group(idx);
+        if(layout_.double_press(idx))
         {
             if(idx == pressed_once_) // 2nd press
             {
-                pressed_once_ = none;
+                once(none);
 
                 if(!pressed_.count(idx))
                 {
-                    if(btn.group) for(auto p_idx : pressed_)
-                        if(buttons_[p_idx].group == btn.group)
-                        {
-                            release(p_idx);
-                            break;
-                        }
+                    release_group(grp);
                     press(idx);
                 }
-                else if(btn.toggle) release(idx);
+                else if(layout_.toggle(idx)) release(idx);
             }
             else // different button
             {
                 if(pressed_once_ != none) un_blink(pressed_once_);
 
-                if(btn.toggle || !pressed_.count(idx))
+                if(layout_.toggle(idx) || !pressed_.count(idx))
                 {
-                    pressed_once_ = idx;
+                    ++metrics().double_press_arms;
+                    once(idx);
                     blink(idx);
                 }
             }
         }
-        else // !btn.double_press
+        else // !double_press
         {
             if(pressed_once_ != none)
             {
                 un_blink(pressed_once_);
-                pressed_once_ = none;
+                once(none);
             }
 
             if(!pressed_.count(idx))
             {
-                if(btn.group) for(auto p_idx : pressed_)
-                    if(buttons_[p_idx].group == btn.group)
-                    {
-                        release(p_idx);
-                        break;
-                    }
+                release_group(grp);
                 press(idx);
             }
-            else if(btn.toggle) release(idx);
+            else if(layout_.toggle(idx)) release(idx);
         }
     }
 
     for(auto idx : released)
-        if(pressed_.count(idx))
-        {
-            auto& btn = buttons_[idx];
-            // toggle and group buttons are released separately
-            if(!btn.toggle && !btn.group) release(idx);
-        }
+    {
+        disarm(idx);
+
+        // toggle and group buttons are released separately
+        if(pressed_.count(idx) && !layout_.toggle(idx) && !layout_.group(idx)) release(idx);
+    }
 
+    if(js_.jog && !locked_) decode_jog_shuttle(n);
+
+    latency().dispatch.record(since(time_.mono));
+
+    if(dcall_) dcall_(time_);
     sched_read();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 auto device::decode_buttons() -> std::tuple<indices, indices>
 {
-    indices pressed, released;
-
     auto data = data_.as<general_data>();
-    auto prev = prev_.as<general_data>();
 
-    if(data->ps != prev->ps)
+    // diff whole bitmasks a word at a time
+    auto curr = indices::from(data->buttons, columns_) & mask_;
+    if(data->ps) curr.insert(ps);
+
+    auto pressed  =  curr & ~prev_;
+    auto released = ~curr &  prev_;
+    prev_ = curr;
+
+    return { pressed, released };
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void device::decode_jog_shuttle(std::size_t n)
+{
+    if(n <= std::max(js_.jog, js_.shuttle)) return;
+
+    // shuttle position changes rarely - send right away
+    int shuttle = static_cast<std::int8_t>(data_[js_.shuttle]);
+    if(shuttle != shuttle_)
     {
-        if(data->ps) pressed.insert(ps);
-        else released.insert(ps);
+        shuttle_ = shuttle;
+        if(scall_) scall_(shuttle, time_);
+    }
+
+    // jog produces a report for each step - merge them
+    if(int delta = static_cast<std::int8_t>(data_[js_.jog]))
+    {
+        jog_ += delta;
+
+        auto interval = layout_.jog_interval();
+        if(!interval.count()) emit_jog(time_);
+
+        else if(!jog_armed_)
+        {
+            jog_armed_ = true;
+            jog_timer_.expires_after(interval);
+            jog_timer_.async_wait([this](const asio::error_code& ec)
+            {
+                if(ec) return;
+                jog_armed_ = false;
 
-        prev->ps = data->ps;
+                auto time = timestamp::now();
+                emit_jog(time);
+                if(dcall_) dcall_(time);
+            });
+        }
     }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void device::emit_jog(const timestamp& time)
+{
+    if(jog_ && jcall_) jcall_(jog_, time);
+    jog_ = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void device::set_layout(pie::layout layout)
+{
+    if(layout.buttons() != layout_.buttons()) throw std::invalid_argument{
+        "Layout size mismatch"
+    };
+    layout_ = std::move(layout);
 
-    index idx = 0;
-    for(auto col = 0; col < columns_; ++col)
+    // stop blinking if no longer double-press
+    if(pressed_once_ != none && !layout_.double_press(pressed_once_))
     {
-        auto on =  data->buttons[col] & ~prev->buttons[col];
-        auto off= ~data->buttons[col] &  prev->buttons[col];
-        prev->buttons[col] = data->buttons[col];
+        auto idx = pressed_once_;
+        once(none);
+        un_blink(idx);
+    }
 
-        for(auto row = 0; row < rows_; ++row)
+    active_.assign(layout_.groups(), none);
+    for(auto idx : pressed_)
+    {
+        if(idx == ps) continue;
+
+        if(auto grp = layout_.group(idx))
         {
-            if(on & 1) pressed.insert(idx);
-            on >>= 1;
+            // only one button can remain active in each group
+            if(active_[grp - 1] == none)
+                active_[grp - 1] = idx;
+            else release(idx);
+        }
+        // release buttons that are no longer latched and not being held
+        else if(!layout_.toggle(idx) && !prev_.count(idx)) release(idx);
+    }
+
+    if(dcall_) dcall_(timestamp::now());
+}
 
-            if(off & 1) released.insert(idx);
-            off >>= 1;
+////////////////////////////////////////////////////////////////////////////////
+void device::once(index idx)
+{
+    pressed_once_ = idx;
+    if(!wheel_) return;
+
+    wheel_->cancel(once_timer_);
+    once_timer_ = timer_wheel::none;
+
+    if(idx != none)
+        if(auto timeout = layout_.timeout(idx); timeout.count())
+            once_timer_ = wheel_->start(timeout, [this]
+            {
+                once_timer_ = timer_wheel::none;
+                ++metrics().double_press_timeouts;
 
-            ++idx;
+                auto idx = pressed_once_;
+                once(none);
+                un_blink(idx);
+            });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void device::arm(index idx)
+{
+    if(!wheel_) return;
+    disarm(idx);
+
+    if(auto time = layout_.long_press(idx); time.count())
+        long_timers_[idx] = wheel_->start(time, [=]
+        {
+            long_timers_[idx] = timer_wheel::none;
+            if(layout_.long_press(idx).count()) emit(lcall_, idx);
+        });
+
+    if(auto delay = layout_.repeat_delay(idx); delay.count())
+        repeat_timers_[idx] = wheel_->start(delay, [=]{ auto_repeat(idx); });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void device::disarm(index idx)
+{
+    if(!wheel_) return;
+
+    wheel_->cancel(long_timers_[idx]);
+    long_timers_[idx] = timer_wheel::none;
+
+    wheel_->cancel(repeat_timers_[idx]);
+    repeat_timers_[idx] = timer_wheel::none;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void device::cancel_timers()
+{
+    if(!wheel_) return;
+
+    wheel_->cancel(once_timer_);
+    once_timer_ = timer_wheel::none;
+
+    for(std::size_t n = 0; n < long_timers_.size(); ++n) disarm(static_cast<index>(n));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void device::auto_repeat(index idx)
+{
+    repeat_timers_[idx] = timer_wheel::none;
+    if(!layout_.repeat_delay(idx).count()) return;
+
+    emit(acall_, idx);
+
+    auto rate = layout_.repeat_rate(idx);
+    if(rate.count()) repeat_timers_[idx] = wheel_->start(rate, [=]{ auto_repeat(idx); });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void device::emit(const callback& cb, index idx)
+{
+    auto time = timestamp::now();
+    if(cb) cb(event{ idx, time });
+    if(dcall_) dcall_(time);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+auto device::latched() const -> snapshot
+{
+    snapshot snap;
+    for(auto idx : pressed_)
+        if(idx != ps && (layout_.toggle(idx) || layout_.group(idx))) snap.latched.insert(idx);
+
+    snap.locked = locked_;
+    return snap;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void device::restore(const snapshot& snap, bool announce)
+{
+    if(announce) time_ = timestamp::now();
+
+    for(auto idx : snap.latched)
+    {
+        if(idx >= buttons() || pressed_.count(idx)) continue;
+
+        // skip buttons that are no longer latching
+        // or whose group already has an active member
+        auto grp = layout_.group(idx);
+        if(!layout_.toggle(idx) && !grp) continue;
+        if(grp && active_[grp - 1] != none) continue;
+
+        if(announce) press(idx);
+        else
+        {
+            activate(idx);
+            if(grp) active_[grp - 1] = idx;
+            pressed_.insert(idx);
         }
-        idx += CHAR_BIT - rows_;
     }
 
-    return { std::move(pressed), std::move(released) };
+    if(snap.locked != locked_) toggle_locked();
+    if(announce && dcall_) dcall_(time_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void device::set_light(index idx, state s)
+{
+    override_[idx] = s;
+    if(s != off) show_override(idx);
+
+    else if(locked_)
+    {
+        light_state(out_, columns_, idx, light::bank_1, off);
+        light_state(out_, columns_, idx, light::bank_2, on);
+    }
+    else if(idx == pressed_once_) blink(idx);
+    else un_blink(idx);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void device::show_override(index idx)
+{
+    light_state(out_, columns_, idx, light::bank_1, off);
+    light_state(out_, columns_, idx, light::bank_2, override_[idx]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void device::release_group(byte grp)
+{
+    if(grp && active_[grp - 1] != none) release(active_[grp - 1]);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void device::toggle_locked()
 {
     locked_ = !locked_;
+    ++metrics().lock_toggles;
+
     if(locked_)
     {
-        light_on(fd_, light::bank_1, no_rows);
-        light_on(fd_, light::bank_2, all_rows);
+        light_on(out_, light::bank_1, no_rows);
+        light_on(out_, light::bank_2, all_rows);
     }
     else
     {
-        light_on(fd_, light::bank_1, all_rows);
-        light_on(fd_, light::bank_2, no_rows);
+        light_on(out_, light::bank_1, all_rows);
+        light_on(out_, light::bank_2, no_rows);
 
         for(auto idx : pressed_) activate(idx);
     }
+
+    // row commands above clobber individual lights
+    for(std::size_t n = 0; n < override_.size(); ++n)
+        if(override_[n] != off) show_override(static_cast<index>(n));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void device::blink(index idx)
 {
-    light_state(fd_, columns_, idx, light::bank_1, off);
-    light_state(fd_, columns_, idx, light::bank_2, flash);
+    if(override_[idx] != off) return;
+
+    light_state(out_, columns_, idx, light::bank_1, off);
+    light_state(out_, columns_, idx, light::bank_2, flash);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -237,26 +586,34 @@ void device::un_blink(index idx)
 ////////////////////////////////////////////////////////////////////////////////
 void device::activate(index idx)
 {
-    light_state(fd_, columns_, idx, light::bank_1, off);
-    light_state(fd_, columns_, idx, light::bank_2, on);
+    if(override_[idx] != off) return;
+
+    light_state(out_, columns_, idx, light::bank_1, off);
+    light_state(out_, columns_, idx, light::bank_2, on);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void device::deactivate(index idx)
 {
-    light_state(fd_, columns_, idx, light::bank_1, on);
-    light_state(fd_, columns_, idx, light::bank_2, off);
+    if(override_[idx] != off) return;
+
+    light_state(out_, columns_, idx, light::bank_1, on);
+    light_state(out_, columns_, idx, light::bank_2, off);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void device::press(index idx)
 {
     if(idx != ps)
+    {
         activate(idx);
-    else led_state(fd_, led::red, on);
+        if(auto grp = layout_.group(idx)) active_[grp - 1] = idx;
+    }
+    else led_state(out_, led::red, on);
 
     pressed_.insert(idx);
-    if(pcall_) pcall_(idx);
+    ++metrics().presses;
+    if(pcall_) pcall_(event{ idx, time_ });
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -266,11 +623,15 @@ void device::release(index idx)
     {
         // when locked, leave the button red (bank_2)
         if(!locked_) deactivate(idx);
+
+        auto grp = layout_.group(idx);
+        if(grp && active_[grp - 1] == idx) active_[grp - 1] = none;
     }
-    else led_state(fd_, led::red, off);
+    else led_state(out_, led::red, off);
 
     pressed_.erase(idx);
-    if(rcall_) rcall_(idx);
+    ++metrics().releases;
+    if(rcall_) rcall_(event{ idx, time_ });
 }
 
 ////////////////////////////////////////////////////////////////////////////////
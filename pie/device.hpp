@@ -9,14 +9,19 @@
 #define PIE_DEVICE_HPP
 
 ////////////////////////////////////////////////////////////////////////////////
+#include "index_set.hpp"
+#include "layout.hpp"
+#include "queue.hpp"
+#include "timer_wheel.hpp"
+#include "transport.hpp"
 #include "types.hpp"
 
+#include <array>
 #include <asio.hpp>
 #include <filesystem>
 #include <functional>
 #include <initializer_list>
-#include <optional>
-#include <set>
+#include <memory>
 #include <tuple>
 #include <vector>
 
@@ -28,68 +33,181 @@ namespace pie
 
 ////////////////////////////////////////////////////////////////////////////////
 using index_list = std::initializer_list<index>;
-using callback = std::function<void (index)>;
+
+struct event
+{
+    index idx;
+    timestamp time; // when the report was received
+};
+
+using callback = std::function<void (const event&)>;
+using value_callback = std::function<void (int value, const timestamp&)>;
+using report_callback = std::function<void (const timestamp&)>;
+using ready_callback = std::function<void (const asio::error_code&)>;
 
 ////////////////////////////////////////////////////////////////////////////////
 class device
 {
 public:
-    device(asio::io_context&, const fs::path&);
+    // sync    - read descriptor and set up the keypad before returning
+    // async   - do the same on the io_context, then call on_ready
+    // minimal - only read descriptor (eg, to change uid)
+    enum init { sync, async, minimal };
+
+    device(asio::io_context&, const fs::path&, init = sync);
+    explicit device(std::unique_ptr<transport>, init = sync);
+    ~device();
+
+    // called when async init is done or has failed
+    // (right away if the device is already set up)
+    void on_ready(ready_callback);
+    bool ready() const { return ready_; }
+
+    void close();
+
+    // enable double-press timeout, long-press and auto-repeat
+    void set_timers(timer_wheel& wheel) { wheel_ = &wheel; }
 
     void set_uid(byte);
     auto uid() const { return uid_; }
 
     auto columns() const { return columns_; }
     auto rows() const { return rows_; }
-    auto buttons() const { return buttons_.size(); }
+    auto buttons() const { return layout_.buttons(); }
 
     // mark button(s) as double-press
-    void set_double_press(index idx) { buttons_.at(idx).double_press = true; }
+    void set_double_press(index idx) { layout_.set_double_press(idx); }
     template<typename It>
     void set_double_press(It begin, It end) { for(auto it = begin; it != end; ++it) set_double_press(*it); }
     void set_double_press(index_list il) { set_double_press(il.begin(), il.end()); }
 
     // mark button(s) as toggle
-    void set_toggle(index idx) { buttons_.at(idx).toggle = true; }
+    void set_toggle(index idx) { layout_.set_toggle(idx); }
     template<typename It>
     void set_toggle(It begin, It end) { for(auto it = begin; it != end; ++it) set_toggle(*it); }
     void set_toggle(index_list il) { set_toggle(il.begin(), il.end()); }
 
     // add button(s) to a group
-    void set_group(index idx, int id) { buttons_.at(idx).group = id; }
+    void set_group(index idx, int id) { layout_.set_group(idx, id); active_.resize(layout_.groups(), none); }
     template<typename It>
     void set_group(It begin, It end, int id) { for(auto it = begin; it != end; ++it) set_group(*it, id); }
     void set_group(index_list il, int id) { set_group(il.begin(), il.end(), id); }
 
+    const auto& layout() const { return layout_; }
+
+    // number of currently pressed (or active) buttons
+    auto pressed() const { return pressed_.size(); }
+
+    // latched state (active toggle and group buttons and lock), which
+    // survives device replug or restart
+    struct snapshot
+    {
+        index_set latched;
+        bool locked = false;
+    };
+    snapshot latched() const;
+
+    // restore latched state (should be called after set_layout); if announce
+    // is true, emits press events for the restored buttons
+    void restore(const snapshot&, bool announce = false);
+
+    // replace button behaviour on the fly, preserving current state
+    // where it still makes sense
+    void set_layout(pie::layout);
+
+    // LED feedback driven from outside: on and flash light the button red
+    // regardless of its state, off hands it back to the device
+    void set_light(index, state);
+    void set_led(led::color c, state s) { led_state(out_, c, s); }
+    void set_level(byte bank_1, byte bank_2) { level(out_, bank_1, bank_2); }
+
     void on_press(callback cb) { pcall_ = std::move(cb); }
     void on_release(callback cb) { rcall_ = std::move(cb); }
 
+    // called when a button has been held for some time
+    // and periodically while it's held
+    void on_long_press(callback cb) { lcall_ = std::move(cb); }
+    void on_repeat(callback cb) { acall_ = std::move(cb); }
+
+    // jog & shuttle models only: jog movement (+ = clockwise)
+    // and new shuttle position (-7..7)
+    bool has_jog_shuttle() const { return js_.jog; }
+    void on_jog(value_callback cb) { jcall_ = std::move(cb); }
+    void on_shuttle(value_callback cb) { scall_ = std::move(cb); }
+
+    // called after all events from one report have been delivered
+    void on_report(report_callback cb) { dcall_ = std::move(cb); }
+
 private:
-    fd fd_;
-    byte uid_;
-    byte columns_, rows_;
+    std::unique_ptr<transport> tp_;
+    queue out_{ *tp_ };
 
-    struct button
-    {
-        bool double_press = false;
-        bool toggle = false;
-        std::optional<int> group;
-    };
-    std::vector<button> buttons_;
+    byte uid_ = 0;
+    byte columns_ = 0, rows_ = 0;
+
+    bool ready_ = false;
+    ready_callback ycall_;
+
+    asio::steady_timer init_timer_{ tp_->io() };
+    int retries_ = 0;
+
+    void sched_descriptor();
+    void read_descriptor(const asio::error_code&, std::size_t n);
+    void sched_retry();
+    void init_done(const asio::error_code&);
+
+    void describe(const recv&);
+    void setup();
+
+    // offsets of jog & shuttle data in general_data report (0 = none)
+    struct offsets { std::size_t jog = 0, shuttle = 0; } js_;
+
+    pie::layout layout_;
 
-    callback pcall_, rcall_;
+    // currently active member of each group
+    std::vector<index> active_;
+    void release_group(byte grp);
 
-    recv data_{ }, prev_{ };
+    callback pcall_, rcall_, lcall_, acall_;
+    value_callback jcall_, scall_;
+    report_callback dcall_;
+
+    int jog_ = 0, shuttle_ = 0;
+    asio::steady_timer jog_timer_{ tp_->io() };
+    bool jog_armed_ = false;
+
+    void decode_jog_shuttle(std::size_t n);
+    void emit_jog(const timestamp&);
+
+    timer_wheel* wheel_ = nullptr;
+    timer_wheel::id once_timer_ = timer_wheel::none;
+    std::array<timer_wheel::id, 256> long_timers_{ }, repeat_timers_{ };
+
+    void arm(index);
+    void disarm(index);
+    void cancel_timers();
+
+    void auto_repeat(index);
+    void emit(const callback&, index);
+
+    recv data_{ };
+    timestamp time_;
     void sched_read();
 
-    using indices = std::set<index>;
+    using indices = index_set;
+    indices mask_, prev_;
 
     void read_data(const asio::error_code&, std::size_t n);
     std::tuple<indices, indices> decode_buttons();
 
     index pressed_once_ = none;
+    void once(index);
+
     indices pressed_;
 
+    std::array<state, 256> override_{ };
+    void show_override(index);
+
     void blink(index);
     void un_blink(index);
     void activate(index);
@@ -0,0 +1,135 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2020-2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#ifndef PIE_INDEX_SET_HPP
+#define PIE_INDEX_SET_HPP
+
+////////////////////////////////////////////////////////////////////////////////
+#include "types.hpp"
+
+#include <array>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace pie
+{
+
+////////////////////////////////////////////////////////////////////////////////
+// Fixed-size set of button indices backed by a bitmask.
+//
+// Covers the whole index range (including ps and none), never allocates and
+// mimics the subset of std::set interface used by the device.
+//
+class index_set
+{
+    using bits = std::uint64_t;
+    static constexpr std::size_t width = sizeof(bits) * CHAR_BIT;
+    static constexpr std::size_t words = (1 << (sizeof(index) * CHAR_BIT)) / width;
+
+public:
+    constexpr index_set() = default;
+
+    // build set from packed button data (1 bit per button, LSB first)
+    static index_set from(const byte* data, std::size_t n)
+    {
+        index_set set;
+        for(std::size_t i = 0; i < n && i < words * sizeof(bits); ++i)
+            set.bits_[i / sizeof(bits)] |= bits{ data[i] } << (i % sizeof(bits) * CHAR_BIT);
+        return set;
+    }
+
+    auto count(index idx) const { return (bits_[idx / width] >> (idx % width)) & 1; }
+    void insert(index idx) { bits_[idx / width] |= bits{ 1 } << (idx % width); }
+    void erase(index idx) { bits_[idx / width] &= ~(bits{ 1 } << (idx % width)); }
+    void clear() { bits_ = { }; }
+
+    bool empty() const
+    {
+        for(auto b : bits_) if(b) return false;
+        return true;
+    }
+    std::size_t size() const
+    {
+        std::size_t n = 0;
+        for(auto b : bits_) n += __builtin_popcountll(b);
+        return n;
+    }
+
+    index_set& operator&=(const index_set& rhs) { for(std::size_t i = 0; i < words; ++i) bits_[i] &= rhs.bits_[i]; return *this; }
+    index_set& operator|=(const index_set& rhs) { for(std::size_t i = 0; i < words; ++i) bits_[i] |= rhs.bits_[i]; return *this; }
+
+    index_set operator~() const
+    {
+        index_set set;
+        for(std::size_t i = 0; i < words; ++i) set.bits_[i] = ~bits_[i];
+        return set;
+    }
+
+    friend index_set operator&(index_set lhs, const index_set& rhs) { return lhs &= rhs; }
+    friend index_set operator|(index_set lhs, const index_set& rhs) { return lhs |= rhs; }
+
+    friend bool operator==(const index_set& lhs, const index_set& rhs) { return lhs.bits_ == rhs.bits_; }
+    friend bool operator!=(const index_set& lhs, const index_set& rhs) { return lhs.bits_ != rhs.bits_; }
+
+    ////////////////////
+    // iterates over set bits in ascending order using count-trailing-zeros;
+    // holds a copy of the current word, so the set can be modified while
+    // iterating
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = index;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const index*;
+        using reference = index;
+
+        index operator*() const { return static_cast<index>(n_ * width + __builtin_ctzll(word_)); }
+
+        const_iterator& operator++()
+        {
+            word_ &= word_ - 1;
+            skip();
+            return *this;
+        }
+        const_iterator operator++(int) { auto it = *this; ++*this; return it; }
+
+        bool operator==(const const_iterator& rhs) const { return n_ == rhs.n_ && word_ == rhs.word_; }
+        bool operator!=(const const_iterator& rhs) const { return !(*this == rhs); }
+
+    private:
+        friend class index_set;
+        const_iterator(const index_set* set, std::size_t n) :
+            set_{ set }, n_{ n }, word_{ n < words ? set->bits_[n] : 0 }
+        { skip(); }
+
+        const index_set* set_;
+        std::size_t n_;
+        bits word_;
+
+        void skip()
+        {
+            while(!word_ && n_ < words)
+                if(++n_ < words) word_ = set_->bits_[n_];
+        }
+    };
+
+    auto begin() const { return const_iterator{ this, 0 }; }
+    auto end() const { return const_iterator{ this, words }; }
+
+private:
+    std::array<bits, words> bits_{ };
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif
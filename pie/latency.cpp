@@ -0,0 +1,103 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2020-2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#include "latency.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace pie
+{
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t histogram::bucket(std::uint64_t v)
+{
+    if(v < 2 * sub_count) return v;
+
+    unsigned e = 63 - __builtin_clzll(v);
+    return (e - sub_bits + 1) * sub_count + ((v >> (e - sub_bits)) & (sub_count - 1));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::uint64_t histogram::lower(std::size_t b)
+{
+    if(b < 2 * sub_count) return b;
+
+    unsigned e = b / sub_count + sub_bits - 1;
+    return std::uint64_t{ sub_count + b % sub_count } << (e - sub_bits);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void histogram::record(nanoseconds ns)
+{
+    std::uint64_t v = ns.count() > 0 ? ns.count() : 0;
+
+    ++counts_[bucket(v)];
+    ++total_;
+    if(v > max_) max_ = v;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+nanoseconds histogram::percentile(double p) const
+{
+    if(!total_) return { };
+
+    std::uint64_t n = p / 100 * total_;
+    if(n >= total_) return max();
+
+    std::uint64_t sum = 0;
+    for(std::size_t b = 0; b < counts_.size(); ++b)
+    {
+        sum += counts_[b];
+        // report upper bound of the bucket
+        if(sum > n) return std::min(nanoseconds( lower(b + 1) - 1 ), max());
+    }
+    return max();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+latencies& latency()
+{
+    static latencies l;
+    return l;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::ostream& operator<<(std::ostream& os, const latencies& l)
+{
+    auto us = [](nanoseconds ns) { return ns.count() / 1000.; };
+
+    auto print = [&](const char* name, const histogram& h)
+    {
+        os << std::setw(10) << name << std::setw(10) << h.count()
+           << std::fixed << std::setprecision(1)
+           << std::setw(10) << us(h.percentile(50))
+           << std::setw(10) << us(h.percentile(90))
+           << std::setw(10) << us(h.percentile(99))
+           << std::setw(10) << us(h.percentile(99.9))
+           << std::setw(10) << us(h.max())
+           << "\n";
+    };
+
+    os << std::setw(10) << "stage" << std::setw(10) << "count"
+       << std::setw(10) << "p50,us" << std::setw(10) << "p90,us"
+       << std::setw(10) << "p99,us" << std::setw(10) << "p99.9,us"
+       << std::setw(10) << "max,us" << "\n";
+
+    print("decode", l.decode);
+    print("dispatch", l.dispatch);
+    print("serialize", l.serialize);
+    print("send", l.send);
+    print("led", l.led);
+
+    return os;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}
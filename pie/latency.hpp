@@ -0,0 +1,83 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2020-2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#ifndef PIE_LATENCY_HPP
+#define PIE_LATENCY_HPP
+
+////////////////////////////////////////////////////////////////////////////////
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace pie
+{
+
+////////////////////////////////////////////////////////////////////////////////
+using std::chrono::nanoseconds;
+
+////////////////////////////////////////////////////////////////////////////////
+// Log-linear latency histogram (HDR-style).
+//
+// Each power of 2 is split into 8 sub-buckets, which gives ~12.5% precision
+// over the whole range. Recording a value is a few arithmetic operations and
+// never allocates.
+//
+class histogram
+{
+public:
+    void record(nanoseconds);
+    void reset() { counts_ = { }; total_ = 0; max_ = 0; }
+
+    auto count() const { return total_; }
+    auto max() const { return nanoseconds{ max_ }; }
+
+    // p = 0..100
+    nanoseconds percentile(double p) const;
+
+private:
+    static constexpr unsigned sub_bits = 3;
+    static constexpr unsigned sub_count = 1 << sub_bits;
+
+    std::array<std::uint64_t, (64 - sub_bits + 1) * sub_count> counts_{ };
+    std::uint64_t total_ = 0, max_ = 0;
+
+    static std::size_t bucket(std::uint64_t);
+    static std::uint64_t lower(std::size_t bucket);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Latency of each processing stage, measured from the time when the report
+// was received (except led, which measures duration of LED writes).
+//
+struct latencies
+{
+    histogram decode;    // report decoded
+    histogram dispatch;  // state machine done
+    histogram serialize; // OSC packet/bundle ready
+    histogram send;      // OSC packet sent
+    histogram led;       // LED commands written
+};
+
+// process-wide latency stats
+latencies& latency();
+
+std::ostream& operator<<(std::ostream&, const latencies&);
+
+////////////////////////////////////////////////////////////////////////////////
+// time elapsed since tp
+inline auto since(std::chrono::steady_clock::time_point tp)
+{
+    return std::chrono::duration_cast<nanoseconds>(std::chrono::steady_clock::now() - tp);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -0,0 +1,30 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2020-2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#include "layout.hpp"
+
+#include <cstdint>
+#include <stdexcept>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace pie
+{
+
+////////////////////////////////////////////////////////////////////////////////
+byte layout::slot(int id)
+{
+    for(std::size_t slot = 0; slot < ids_.size(); ++slot)
+        if(ids_[slot] == id) return slot;
+
+    if(ids_.size() >= max_groups) throw std::out_of_range{ "Too many groups" };
+
+    ids_.push_back(id);
+    return ids_.size() - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,87 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2020-2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#ifndef PIE_LAYOUT_HPP
+#define PIE_LAYOUT_HPP
+
+////////////////////////////////////////////////////////////////////////////////
+#include "types.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace pie
+{
+
+////////////////////////////////////////////////////////////////////////////////
+// Button behaviour compiled into flat per-button tables.
+//
+// Group ids are mapped onto dense slots, so that the device can keep per-group
+// state in a plain array.
+//
+class layout
+{
+public:
+    using msec = std::chrono::milliseconds;
+
+    // group slots are stored in a byte (0 = no group)
+    static constexpr std::size_t max_groups = UINT8_MAX;
+
+    explicit layout(std::size_t buttons = 0) :
+        flags_(buttons), group_(buttons), timeout_(buttons), long_(buttons), delay_(buttons), rate_(buttons)
+    { }
+
+    auto buttons() const { return flags_.size(); }
+    auto groups() const { return ids_.size(); }
+
+    void set_double_press(index idx) { flags_.at(idx) |= double_press_flag; }
+    void set_toggle(index idx) { flags_.at(idx) |= toggle_flag; }
+    void set_group(index idx, int id) { group_.at(idx) = slot(id) + 1; }
+
+    // double-press button stops blinking after timeout (0 = never)
+    void set_double_press(index idx, msec timeout) { set_double_press(idx); timeout_.at(idx) = timeout; }
+    // emit long-press event after button is held for the given time
+    void set_long_press(index idx, msec time) { long_.at(idx) = time; }
+    // emit repeat events while button is held
+    void set_repeat(index idx, msec delay, msec rate) { delay_.at(idx) = delay; rate_.at(idx) = rate; }
+
+    bool double_press(index idx) const { return flags_[idx] & double_press_flag; }
+    bool toggle(index idx) const { return flags_[idx] & toggle_flag; }
+
+    // group slot + 1 (0 = no group)
+    auto group(index idx) const { return group_[idx]; }
+
+    auto timeout(index idx) const { return timeout_[idx]; }
+    auto long_press(index idx) const { return long_[idx]; }
+    auto repeat_delay(index idx) const { return delay_[idx]; }
+    auto repeat_rate(index idx) const { return rate_[idx]; }
+
+    // merge jog movements over this interval (0 = send with each report)
+    void set_jog_interval(msec interval) { jog_interval_ = interval; }
+    auto jog_interval() const { return jog_interval_; }
+
+private:
+    enum flag : byte { double_press_flag = 0x01, toggle_flag = 0x02 };
+    std::vector<byte> flags_;
+    std::vector<byte> group_;
+
+    // timing in ms (0 = off)
+    std::vector<msec> timeout_, long_, delay_, rate_;
+    msec jog_interval_{ 8 };
+
+    std::vector<int> ids_; // group id for each slot
+    byte slot(int id);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif
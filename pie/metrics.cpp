@@ -0,0 +1,53 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#include "metrics.hpp"
+
+#include <ostream>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace pie
+{
+
+////////////////////////////////////////////////////////////////////////////////
+counters& metrics()
+{
+    static counters c;
+    return c;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::ostream& operator<<(std::ostream& os, const counters& c)
+{
+    auto print = [&](const char* name, std::uint64_t value, const char* help)
+    {
+        os << "# HELP baker_" << name << " " << help << "\n"
+           << "# TYPE baker_" << name << " counter\n"
+           << "baker_" << name << " " << value << "\n";
+    };
+
+    print("reports_total", c.reports, "HID reports read.");
+    print("short_reads_total", c.short_reads, "HID reports too short to decode.");
+    print("rt_dropped_reports_total", c.rt_dropped, "HID reports dropped by the reader thread, because its ring was full.");
+    print("presses_total", c.presses, "Button press events.");
+    print("releases_total", c.releases, "Button release events.");
+    print("double_press_arms_total", c.double_press_arms, "First presses of double-press buttons.");
+    print("double_press_timeouts_total", c.double_press_timeouts, "Double-press buttons not pressed again in time.");
+    print("lock_toggles_total", c.lock_toggles, "Times the keypad was locked or unlocked.");
+    print("led_commands_total", c.led_commands, "LED commands issued.");
+    print("led_merged_total", c.led_merged, "LED commands merged with a pending one.");
+    print("led_errors_total", c.led_errors, "Failed LED writes.");
+    print("osc_packets_total", c.osc_packets, "OSC packets sent.");
+    print("send_errors_total", c.send_errors, "Failed OSC packet sends.");
+    print("dropped_total", c.dropped, "Events dropped by the rate limiter.");
+    print("stream_dropped_total", c.stream_dropped, "OSC packets dropped from full TCP stream queues.");
+
+    return os;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}
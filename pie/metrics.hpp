@@ -0,0 +1,57 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#ifndef PIE_METRICS_HPP
+#define PIE_METRICS_HPP
+
+////////////////////////////////////////////////////////////////////////////////
+#include <cstdint>
+#include <iosfwd>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace pie
+{
+
+////////////////////////////////////////////////////////////////////////////////
+// Event counters.
+//
+// Only updated from the event loop thread, so they are plain integers kept
+// together on their own cache lines.
+//
+struct alignas(64) counters
+{
+    std::uint64_t reports = 0;      // HID reports read
+    std::uint64_t short_reads = 0;  // reports too short to decode
+    std::uint64_t rt_dropped = 0;   // reports dropped by reader thread (ring full)
+
+    std::uint64_t presses = 0;
+    std::uint64_t releases = 0;
+    std::uint64_t double_press_arms = 0;     // first press of a double-press button
+    std::uint64_t double_press_timeouts = 0; // second press didn't come in time
+    std::uint64_t lock_toggles = 0;
+
+    std::uint64_t led_commands = 0; // LED commands issued
+    std::uint64_t led_merged = 0;   // merged with a pending one
+    std::uint64_t led_errors = 0;   // failed writes
+
+    std::uint64_t osc_packets = 0;  // OSC packets sent (per destination)
+    std::uint64_t send_errors = 0;
+    std::uint64_t dropped = 0;      // events dropped by the rate limiter
+    std::uint64_t stream_dropped = 0; // packets dropped from full TCP stream queues
+};
+
+// process-wide counters
+counters& metrics();
+
+// print in Prometheus text format
+std::ostream& operator<<(std::ostream&, const counters&);
+
+////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -0,0 +1,112 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2020-2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#include "latency.hpp"
+#include "metrics.hpp"
+#include "queue.hpp"
+
+#include <algorithm>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace pie
+{
+
+////////////////////////////////////////////////////////////////////////////////
+namespace
+{
+
+// commands with the same key overwrite each other
+word key(const send& data)
+{
+    auto cmd = data[1];
+    switch(cmd)
+    {
+    case 179: // led_state
+    case 181: // light_state
+    case 182: // light_on
+        return cmd << 8 | data[2];
+
+    default: return cmd << 8;
+    }
+}
+
+constexpr std::size_t reserve = 64;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+queue::queue(transport& tp) : tp_{ tp }
+{
+    pending_.reserve(reserve);
+    writing_.reserve(reserve);
+    buffers_.reserve(reserve);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void queue::push(const send& data)
+{
+    // move merged command to the end to preserve its order
+    // relative to other commands (eg, light_on vs light_state)
+    auto k = key(data);
+    auto it = std::remove_if(pending_.begin(), pending_.end(),
+        [&](const send& p) { return key(p) == k; }
+    );
+    metrics().led_merged += pending_.end() - it;
+    pending_.erase(it, pending_.end());
+
+    pending_.push_back(data);
+    ++metrics().led_commands;
+
+    if(!posted_ && !busy_)
+    {
+        posted_ = true;
+        asio::post(tp_.io(), [this]{ posted_ = false; sched_write(); });
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void queue::sync()
+{
+    for(auto& data : pending_) tp_.write(asio::buffer(data));
+    pending_.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void queue::sched_write()
+{
+    if(busy_ || pending_.empty() || !tp_.is_open()) return;
+
+    std::swap(pending_, writing_);
+    pending_.clear();
+
+    // hidraw handles each buffer as a separate report
+    buffers_.clear();
+    for(auto& data : writing_) buffers_.push_back(asio::buffer(data));
+
+    busy_ = true;
+    start_ = std::chrono::steady_clock::now();
+
+    tp_.async_write(buffers_, [this](const asio::error_code& ec, std::size_t n){ write_done(ec, n); });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void queue::write_done(const asio::error_code& ec, std::size_t)
+{
+    busy_ = false;
+    if(ec)
+    {
+        if(ec != asio::error::operation_aborted) ++metrics().led_errors;
+        return;
+    }
+
+    latency().led.record(since(start_));
+
+    sched_write();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}
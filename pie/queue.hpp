@@ -0,0 +1,57 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2020-2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#ifndef PIE_QUEUE_HPP
+#define PIE_QUEUE_HPP
+
+////////////////////////////////////////////////////////////////////////////////
+#include "transport.hpp"
+#include "types.hpp"
+
+#include <asio.hpp>
+#include <chrono>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace pie
+{
+
+////////////////////////////////////////////////////////////////////////////////
+// Outbound command queue.
+//
+// Commands targeting the same LED (or the same device-wide setting) are
+// merged, with the last one winning. Pending commands are written in one
+// batch after the current handler returns, so they never delay the read path.
+//
+class queue
+{
+public:
+    explicit queue(transport&);
+
+    void push(const send&);
+
+    // write pending commands synchronously
+    // (must not be used while the event loop is running)
+    void sync();
+
+private:
+    transport& tp_;
+
+    std::vector<send> pending_, writing_;
+    buffers buffers_;
+    bool posted_ = false, busy_ = false;
+    std::chrono::steady_clock::time_point start_;
+
+    void sched_write();
+    void write_done(const asio::error_code&, std::size_t);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif
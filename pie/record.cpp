@@ -0,0 +1,166 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2020-2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#include "record.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace pie
+{
+
+////////////////////////////////////////////////////////////////////////////////
+recorder::recorder(std::unique_ptr<transport> tp, const fs::path& path) : transport{ tp->io() },
+    tp_{ std::move(tp) }, fs_{ path, std::ios::out | std::ios::binary | std::ios::trunc },
+    start_{ std::chrono::steady_clock::now() }
+{
+    if(!fs_.good()) throw std::invalid_argument{ "Can't open file " + path.string() + "." };
+    fs_.write(rec::magic, sizeof(rec::magic));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void recorder::async_read(asio::mutable_buffer buf, io_handler cb)
+{
+    tp_->async_read(buf, [=, cb = std::move(cb)](const asio::error_code& ec, std::size_t n)
+    {
+        if(!ec) log(rec::in, buf.data(), n);
+        cb(ec, n);
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void recorder::async_write(const buffers& bufs, io_handler cb)
+{
+    for(auto& buf : bufs) log(rec::out, buf.data(), buf.size());
+    tp_->async_write(bufs, std::move(cb));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t recorder::read(asio::mutable_buffer buf)
+{
+    auto n = tp_->read(buf);
+    log(rec::in, buf.data(), n);
+    return n;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void recorder::write(asio::const_buffer buf)
+{
+    log(rec::out, buf.data(), buf.size());
+    tp_->write(buf);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void recorder::log(rec::dir dir, const void* data, std::size_t size)
+{
+    rec::header hdr;
+    hdr.time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start_
+    ).count();
+    hdr.dir = dir;
+    hdr.size = std::min<std::size_t>(size, UINT8_MAX);
+
+    fs_.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    fs_.write(static_cast<const char*>(data), hdr.size);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+replayer::replayer(asio::io_context& io, const fs::path& path, speed s) : transport{ io },
+    speed_{ s }, timer_{ io }
+{
+    std::fstream fs{ path, std::ios::in | std::ios::binary };
+    if(!fs.good()) throw std::invalid_argument{ "Can't open file " + path.string() + "." };
+
+    char magic[sizeof(rec::magic)];
+    if(!fs.read(magic, sizeof(magic)) || std::memcmp(magic, rec::magic, sizeof(magic)))
+        throw std::invalid_argument{ "Invalid recording " + path.string() + "." };
+
+    rec::header hdr;
+    while(fs.read(reinterpret_cast<char*>(&hdr), sizeof(hdr)))
+    {
+        record r{ std::chrono::nanoseconds(hdr.time), { }, std::min<std::size_t>(hdr.size, sizeof(recv)) };
+
+        if(!fs.read(reinterpret_cast<char*>(r.data.data()), r.size)) break;
+        fs.ignore(hdr.size - r.size);
+
+        if(hdr.dir == rec::in) records_.push_back(r);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void replayer::async_read(asio::mutable_buffer buf, io_handler cb)
+{
+    if(!open_)
+    {
+        asio::post(io(), [=]{ cb(asio::error::operation_aborted, 0); });
+        return;
+    }
+
+    if(next_ >= records_.size())
+    {
+        asio::post(io(), [=]{ cb(asio::error::eof, 0); });
+        if(ecall_) asio::post(io(), ecall_);
+        return;
+    }
+
+    // start the clock on the first async read
+    if(first_ == decltype(first_){ })
+    {
+        first_ = std::chrono::steady_clock::now();
+        start_ = first_ - records_[next_].time;
+    }
+
+    if(speed_ == max) asio::post(io(), [=]{ cb({ }, play(buf)); });
+    else
+    {
+        timer_.expires_at(start_ + records_[next_].time);
+        timer_.async_wait([=](const asio::error_code& ec)
+        {
+            if(ec || !open_) cb(asio::error::operation_aborted, 0);
+            else cb({ }, play(buf));
+        });
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void replayer::async_write(const buffers& bufs, io_handler cb)
+{
+    std::size_t n = 0;
+    for(auto& buf : bufs) n += buf.size();
+
+    asio::post(io(), [=]{ cb({ }, n); });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t replayer::read(asio::mutable_buffer buf)
+{
+    if(next_ >= records_.size()) throw asio::system_error{ asio::error::eof };
+    return play(buf);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void replayer::close()
+{
+    open_ = false;
+    timer_.cancel();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t replayer::play(asio::mutable_buffer buf)
+{
+    auto& r = records_[next_++];
+    last_ = std::chrono::steady_clock::now();
+
+    auto n = std::min(buf.size(), r.size);
+    std::memcpy(buf.data(), r.data.data(), n);
+    return n;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,133 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2020-2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#ifndef PIE_RECORD_HPP
+#define PIE_RECORD_HPP
+
+////////////////////////////////////////////////////////////////////////////////
+#include "transport.hpp"
+#include "types.hpp"
+
+#include <asio.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+////////////////////////////////////////////////////////////////////////////////
+namespace pie
+{
+
+////////////////////////////////////////////////////////////////////////////////
+// Recording file format (native byte order):
+//
+// magic[4], followed by zero or more records. Each record consists of
+// rec::header followed by the report data.
+//
+namespace rec
+{
+
+constexpr char magic[4] = { 'P', 'I', 'E', 'R' };
+
+enum dir : byte { in = 0, out = 1 };
+
+#pragma pack(push, 1)
+struct header
+{
+    std::uint64_t time; // ns since start of recording
+    byte dir;
+    byte size;
+};
+#pragma pack(pop)
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Transport that logs all IN/OUT reports passing through another transport.
+//
+class recorder : public transport
+{
+public:
+    recorder(std::unique_ptr<transport>, const fs::path&);
+
+    void async_read(asio::mutable_buffer, io_handler) override;
+    void async_write(const buffers&, io_handler) override;
+
+    std::size_t read(asio::mutable_buffer) override;
+    void write(asio::const_buffer) override;
+
+    timestamp read_time() const override { return tp_->read_time(); }
+
+    bool is_open() const override { return tp_->is_open(); }
+    void close() override { tp_->close(); fs_.flush(); }
+
+private:
+    std::unique_ptr<transport> tp_;
+    std::ofstream fs_;
+    std::chrono::steady_clock::time_point start_;
+
+    void log(rec::dir, const void*, std::size_t);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Transport that plays back IN reports from a recording either at original
+// or maximum speed. OUT reports are discarded.
+//
+class replayer : public transport
+{
+public:
+    enum speed { original, max };
+    replayer(asio::io_context&, const fs::path&, speed = original);
+
+    void async_read(asio::mutable_buffer, io_handler) override;
+    void async_write(const buffers&, io_handler) override;
+
+    std::size_t read(asio::mutable_buffer) override;
+    void write(asio::const_buffer) override { }
+
+    bool is_open() const override { return open_; }
+    void close() override;
+
+    // called when all reports have been played back
+    void on_end(std::function<void ()> cb) { ecall_ = std::move(cb); }
+
+    // number of IN reports played back and time it took
+    auto reports() const { return next_; }
+    auto elapsed() const { return last_ - first_; }
+
+private:
+    struct record
+    {
+        std::chrono::nanoseconds time;
+        recv data;
+        std::size_t size;
+    };
+    std::vector<record> records_;
+    std::size_t next_ = 0;
+
+    speed speed_;
+    bool open_ = true;
+
+    asio::steady_timer timer_;
+    std::chrono::steady_clock::time_point start_, first_, last_;
+
+    std::function<void ()> ecall_;
+
+    std::size_t play(asio::mutable_buffer);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -0,0 +1,63 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2020-2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#ifndef PIE_RING_HPP
+#define PIE_RING_HPP
+
+////////////////////////////////////////////////////////////////////////////////
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace pie
+{
+
+////////////////////////////////////////////////////////////////////////////////
+// Fixed-size lock-free single-producer single-consumer ring.
+//
+// push() may only be called from one thread and pop() from one (other) thread.
+// All storage is allocated up front.
+//
+template<typename T, std::size_t N>
+class ring
+{
+    static_assert(N && (N & (N - 1)) == 0, "N must be a power of 2");
+
+public:
+    bool push(const T& value)
+    {
+        auto head = head_.load(std::memory_order_relaxed);
+        if(head - tail_.load(std::memory_order_acquire) == N) return false;
+
+        slots_[head % N] = value;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& value)
+    {
+        auto tail = tail_.load(std::memory_order_relaxed);
+        if(tail == head_.load(std::memory_order_acquire)) return false;
+
+        value = slots_[tail % N];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    // keep producer and consumer on separate cache lines
+    alignas(64) std::atomic<std::size_t> head_{ 0 };
+    alignas(64) std::atomic<std::size_t> tail_{ 0 };
+    alignas(64) std::array<T, N> slots_{ };
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif
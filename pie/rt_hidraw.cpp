@@ -0,0 +1,212 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2020-2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#include "rt_hidraw.hpp"
+#include "metrics.hpp"
+
+#include <cerrno>
+#include <iterator>
+#include <system_error>
+
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace pie
+{
+
+////////////////////////////////////////////////////////////////////////////////
+namespace
+{
+
+int make_eventfd(int flags)
+{
+    auto fd = ::eventfd(0, EFD_CLOEXEC | flags);
+    if(fd == -1) throw std::system_error{
+        std::error_code{ errno, std::generic_category() }
+    };
+    return fd;
+}
+
+void notify(int fd)
+{
+    std::uint64_t one = 1;
+    while(::write(fd, &one, sizeof(one)) == -1 && errno == EINTR);
+}
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+rt_hidraw::rt_hidraw(asio::io_context& io, const fs::path& path, options opt) :
+    hidraw{ io, path }, opt_{ opt }, wake_{ io }
+{
+    stop_ = make_eventfd(0);
+    wake_.assign(make_eventfd(EFD_NONBLOCK));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+rt_hidraw::~rt_hidraw()
+{
+    stop();
+    ::close(stop_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void rt_hidraw::async_read(asio::mutable_buffer buf, io_handler cb)
+{
+    if(!is_open())
+    {
+        asio::post(io(), [cb = std::move(cb)]{ cb(asio::error::bad_descriptor, 0); });
+        return;
+    }
+
+    buf_ = buf;
+    cb_ = std::move(cb);
+
+    if(!thread_.joinable()) start();
+    deliver();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void rt_hidraw::close()
+{
+    stop();
+
+    asio::error_code ec;
+    wake_.close(ec);
+
+    if(cb_)
+    {
+        asio::post(io(), [cb = std::move(cb_)]{ cb(asio::error::operation_aborted, 0); });
+        cb_ = nullptr;
+    }
+
+    hidraw::close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void rt_hidraw::start()
+{
+    thread_ = std::thread{ &rt_hidraw::run, this };
+
+    if(opt_.priority)
+    {
+        sched_param param{ };
+        param.sched_priority = opt_.priority;
+
+        if(auto e = ::pthread_setschedparam(thread_.native_handle(), SCHED_FIFO, &param)) throw std::system_error{
+            std::error_code{ e, std::generic_category() }, "Can't set reader thread priority"
+        };
+    }
+
+    if(opt_.cpu >= 0)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(opt_.cpu, &set);
+
+        if(auto e = ::pthread_setaffinity_np(thread_.native_handle(), sizeof(set), &set)) throw std::system_error{
+            std::error_code{ e, std::generic_category() }, "Can't pin reader thread to CPU"
+        };
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void rt_hidraw::stop()
+{
+    if(thread_.joinable())
+    {
+        notify(stop_);
+        thread_.join();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void rt_hidraw::run()
+{
+    auto wake = wake_.native_handle();
+    pollfd fds[] = { { fd_.native_handle(), POLLIN, 0 }, { stop_, POLLIN, 0 } };
+
+    report r;
+    for(;;)
+    {
+        if(::poll(fds, std::size(fds), -1) == -1)
+        {
+            if(errno == EINTR) continue;
+            error_ = errno;
+            break;
+        }
+        if(fds[1].revents) break;
+
+        if(fds[0].revents & POLLIN)
+        {
+            auto n = ::read(fds[0].fd, r.data.data(), r.data.size());
+            if(n > 0)
+            {
+                r.size = n;
+                r.time = timestamp::now();
+                if(!ring_.push(r)) ++dropped_;
+
+                notify(wake);
+            }
+            else if(n == -1 && (errno == EAGAIN || errno == EINTR)) continue;
+            else
+            {
+                error_ = n ? errno : EIO;
+                break;
+            }
+        }
+        else if(fds[0].revents)
+        {
+            error_ = EIO; // POLLERR or POLLHUP
+            break;
+        }
+    }
+
+    notify(wake);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void rt_hidraw::deliver()
+{
+    // metrics are only updated from the io_context
+    auto dropped = dropped_.load(std::memory_order_relaxed);
+    metrics().rt_dropped += dropped - counted_;
+    counted_ = dropped;
+
+    if(!cb_) return;
+
+    report r;
+    if(ring_.pop(r))
+    {
+        auto n = asio::buffer_copy(buf_, asio::buffer(r.data.data(), r.size));
+        time_ = r.time;
+
+        asio::post(io(), [cb = std::move(cb_), n]{ cb(asio::error_code{ }, n); });
+        cb_ = nullptr;
+    }
+    else if(auto e = error_.load())
+    {
+        asio::post(io(), [cb = std::move(cb_), e]{ cb(asio::error_code{ e, asio::error::get_system_category() }, 0); });
+        cb_ = nullptr;
+    }
+    else if(!waiting_ && wake_.is_open())
+    {
+        waiting_ = true;
+        wake_.async_read_some(asio::buffer(&count_, sizeof(count_)), [this](const asio::error_code& ec, std::size_t)
+        {
+            waiting_ = false;
+            if(!ec) deliver();
+        });
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,94 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2020-2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#ifndef PIE_RT_HIDRAW_HPP
+#define PIE_RT_HIDRAW_HPP
+
+////////////////////////////////////////////////////////////////////////////////
+#include "ring.hpp"
+#include "transport.hpp"
+#include "types.hpp"
+
+#include <asio.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+////////////////////////////////////////////////////////////////////////////////
+namespace pie
+{
+
+////////////////////////////////////////////////////////////////////////////////
+// Hidraw transport that reads IN reports on a dedicated thread.
+//
+// The thread captures each report with its timestamp and hands it over to the
+// io_context through a lock-free ring, so that report capture is not delayed
+// by LED writes or OSC sends. Writes are still done on the io_context.
+//
+// The thread is started on the first async_read(), after the device is done
+// with blocking reads during init.
+//
+class rt_hidraw : public hidraw
+{
+public:
+    struct options
+    {
+        int priority = 0; // SCHED_FIFO priority (0 = don't change)
+        int cpu = -1;     // CPU to pin the thread to (-1 = any)
+    };
+
+    rt_hidraw(asio::io_context&, const fs::path&, options);
+    ~rt_hidraw() override;
+
+    void async_read(asio::mutable_buffer, io_handler) override;
+    timestamp read_time() const override { return time_; }
+
+    void close() override;
+
+    // number of reports dropped because the ring was full
+    auto dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    options opt_;
+
+    struct report
+    {
+        recv data;
+        std::size_t size;
+        timestamp time;
+    };
+    ring<report, 256> ring_;
+    std::atomic<std::size_t> dropped_{ 0 };
+    std::size_t counted_ = 0; // dropped reports added to metrics
+    std::atomic<int> error_{ 0 };
+
+    std::thread thread_;
+    int stop_ = -1; // eventfd to stop the thread
+    asio::posix::stream_descriptor wake_; // eventfd to wake up io_context
+    std::uint64_t count_;
+    bool waiting_ = false;
+
+    asio::mutable_buffer buf_;
+    io_handler cb_;
+    timestamp time_;
+
+    void start();
+    void stop();
+    void run();
+
+    void deliver();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif
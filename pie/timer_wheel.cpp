@@ -0,0 +1,138 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2020-2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#include "timer_wheel.hpp"
+
+#include <algorithm>
+#include <utility>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace pie
+{
+
+////////////////////////////////////////////////////////////////////////////////
+timer_wheel::timer_wheel(asio::io_context& io, clock::duration tick) :
+    timer_{ io }, tick_{ tick }, start_{ clock::now() }
+{ }
+
+////////////////////////////////////////////////////////////////////////////////
+auto timer_wheel::start(clock::duration time, std::function<void ()> cb) -> id
+{
+    // nothing is pending, so the wheel can skip ahead
+    if(!active_) now_ = ticks();
+
+    std::uint32_t idx;
+    if(free_.size())
+    {
+        idx = free_.back();
+        free_.pop_back();
+    }
+    else
+    {
+        idx = entries_.size();
+        entries_.emplace_back();
+    }
+
+    auto& e = entries_[idx];
+    e.expiry = now_ + std::max<std::uint64_t>(1, (time + tick_ - clock::duration{ 1 }) / tick_);
+    e.cb = std::move(cb);
+
+    place(ref{ idx, e.gen });
+    if(!active_++) sched_tick();
+
+    // never returns none
+    return std::uint64_t{ e.gen } << 32 | (idx + 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void timer_wheel::cancel(id t)
+{
+    if(t == none) return;
+
+    std::uint32_t idx = (t & UINT32_MAX) - 1;
+    std::uint32_t gen = t >> 32;
+    if(idx < entries_.size() && entries_[idx].gen == gen && entries_[idx].cb) release(idx);
+
+    if(!active_) timer_.cancel();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void timer_wheel::place(ref r)
+{
+    auto expiry = entries_[r.idx].expiry;
+
+    // find the lowest level at which expiry and now are in the same revolution
+    std::size_t level = 0;
+    while(level + 1 < levels && (expiry >> (bits * (level + 1))) != (now_ >> (bits * (level + 1)))) ++level;
+
+    // timers beyond the top level are parked and re-placed when cascaded
+    auto slot = (expiry >> (bits * level)) & (slots - 1);
+    wheel_[level][slot].push_back(r);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void timer_wheel::release(std::uint32_t idx)
+{
+    auto& e = entries_[idx];
+    e.cb = nullptr;
+    ++e.gen;
+
+    free_.push_back(idx);
+    --active_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void timer_wheel::sched_tick()
+{
+    timer_.expires_at(start_ + (now_ + 1) * tick_);
+    timer_.async_wait([this](const asio::error_code& ec)
+    {
+        if(ec) return;
+
+        for(auto target = ticks(); now_ < target && active_; ) advance();
+        if(active_) sched_tick();
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void timer_wheel::advance()
+{
+    ++now_;
+
+    // cascade higher levels when the lower one wraps around
+    for(std::size_t level = 1; level < levels; ++level)
+    {
+        if(now_ & ((std::uint64_t{ 1 } << (bits * level)) - 1)) break;
+
+        auto& slot = wheel_[level][(now_ >> (bits * level)) & (slots - 1)];
+        auto refs = std::move(slot);
+        slot.clear();
+
+        for(auto& r : refs)
+            if(entries_[r.idx].gen == r.gen) place(r);
+    }
+
+    auto& slot = wheel_[0][now_ & (slots - 1)];
+    auto refs = std::move(slot);
+    slot.clear();
+
+    for(auto& r : refs)
+    {
+        if(entries_[r.idx].gen != r.gen) continue;
+
+        if(entries_[r.idx].expiry > now_) place(r); // parked
+        else
+        {
+            auto cb = std::move(entries_[r.idx].cb);
+            release(r.idx);
+            cb();
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}
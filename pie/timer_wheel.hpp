@@ -0,0 +1,82 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2020-2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#ifndef PIE_TIMER_WHEEL_HPP
+#define PIE_TIMER_WHEEL_HPP
+
+////////////////////////////////////////////////////////////////////////////////
+#include <array>
+#include <asio.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace pie
+{
+
+////////////////////////////////////////////////////////////////////////////////
+// Hierarchical timer wheel.
+//
+// All timers share one steady_timer, which ticks only while there are active
+// timers. Starting and cancelling a timer is O(1); timers beyond the range of
+// the first level are cascaded down as the wheel turns.
+//
+class timer_wheel
+{
+public:
+    using clock = std::chrono::steady_clock;
+    using id = std::uint64_t;
+    static constexpr id none = 0;
+
+    explicit timer_wheel(asio::io_context&, clock::duration tick = std::chrono::milliseconds{ 10 });
+
+    // call cb once after (at least) the given time
+    id start(clock::duration, std::function<void ()> cb);
+    void cancel(id);
+
+    auto size() const { return active_; }
+
+private:
+    static constexpr std::size_t bits = 6, slots = 1 << bits, levels = 4;
+
+    struct entry
+    {
+        std::uint64_t expiry; // in ticks
+        std::uint32_t gen = 0;
+        std::function<void ()> cb;
+    };
+    std::vector<entry> entries_;
+    std::vector<std::uint32_t> free_;
+
+    // stale refs (after cancel) are skipped using generation count
+    struct ref { std::uint32_t idx, gen; };
+    std::array<std::array<std::vector<ref>, slots>, levels> wheel_;
+
+    asio::steady_timer timer_;
+    clock::duration tick_;
+    clock::time_point start_;
+
+    std::uint64_t now_ = 0; // current tick
+    std::size_t active_ = 0;
+
+    std::uint64_t ticks() const { return (clock::now() - start_) / tick_; }
+
+    void place(ref);
+    void release(std::uint32_t idx);
+
+    void sched_tick();
+    void advance();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif
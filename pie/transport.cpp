@@ -0,0 +1,38 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2020-2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#include "transport.hpp"
+
+#include <cerrno>
+#include <system_error>
+
+#include <fcntl.h> // open
+
+////////////////////////////////////////////////////////////////////////////////
+namespace pie
+{
+
+////////////////////////////////////////////////////////////////////////////////
+hidraw::hidraw(asio::io_context& io, const fs::path& path) : transport{ io },
+    fd_{ io }
+{
+    auto fd = ::open(path.c_str(), O_RDWR);
+    if(fd == -1) throw std::system_error{
+        std::error_code{ errno, std::generic_category() }
+    };
+    fd_.assign(fd);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void hidraw::close()
+{
+    asio::error_code ec;
+    fd_.close(ec);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}
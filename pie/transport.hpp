@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2020-2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#ifndef PIE_TRANSPORT_HPP
+#define PIE_TRANSPORT_HPP
+
+////////////////////////////////////////////////////////////////////////////////
+#include "types.hpp"
+
+#include <asio.hpp>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+////////////////////////////////////////////////////////////////////////////////
+namespace pie
+{
+
+////////////////////////////////////////////////////////////////////////////////
+using io_handler = std::function<void (const asio::error_code&, std::size_t)>;
+using buffers = std::vector<asio::const_buffer>;
+
+////////////////////////////////////////////////////////////////////////////////
+// Transport used by the device to exchange reports with the keypad.
+//
+// Each read returns one IN report and each buffer passed to write is one OUT
+// report. Completion handlers are always invoked on the io_context.
+//
+class transport
+{
+public:
+    explicit transport(asio::io_context& io) : io_{ io } { }
+    virtual ~transport() = default;
+
+    auto& io() { return io_; }
+
+    virtual void async_read(asio::mutable_buffer, io_handler) = 0;
+    virtual void async_write(const buffers&, io_handler) = 0;
+
+    // blocking versions used during init
+    virtual std::size_t read(asio::mutable_buffer) = 0;
+    virtual void write(asio::const_buffer) = 0;
+
+    // time when the last IN report was received
+    virtual timestamp read_time() const { return timestamp::now(); }
+
+    virtual bool is_open() const = 0;
+    virtual void close() = 0;
+
+private:
+    asio::io_context& io_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Transport over a hidraw device node.
+//
+class hidraw : public transport
+{
+public:
+    hidraw(asio::io_context&, const fs::path&);
+
+    void async_read(asio::mutable_buffer buf, io_handler cb) override { fd_.async_read_some(buf, std::move(cb)); }
+    void async_write(const buffers& bufs, io_handler cb) override { asio::async_write(fd_, bufs, std::move(cb)); }
+
+    std::size_t read(asio::mutable_buffer buf) override { return fd_.read_some(buf); }
+    void write(asio::const_buffer buf) override { asio::write(fd_, buf); }
+
+    bool is_open() const override { return fd_.is_open(); }
+    void close() override;
+
+protected:
+    fd fd_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -11,6 +11,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 #include <array>
 #include <asio.hpp>
+#include <chrono>
 #include <climits>
 #include <cstdint>
 #include <vector>
@@ -28,6 +29,19 @@ using index = byte;
 constexpr index ps = -1;
 constexpr index none = -2;
 
+////////////////////////////////////////////////////////////////////////////////
+// time when a report was received
+struct timestamp
+{
+    std::chrono::steady_clock::time_point mono;
+    std::chrono::system_clock::time_point real;
+
+    static timestamp now()
+    {
+        return { std::chrono::steady_clock::now(), std::chrono::system_clock::now() };
+    }
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 namespace leds
 {
@@ -68,6 +82,9 @@ struct recv : std::array<byte, 42>
     const T* as() const { return reinterpret_cast<const T*>(data()); }
 };
 
+////////////////////////////////////////////////////////////////////////////////
+using send = std::array<byte, 36>;
+
 ////////////////////////////////////////////////////////////////////////////////
 #pragma pack(push, 1)
 
@@ -105,33 +122,34 @@ struct descriptor_data
 
 ////////////////////////////////////////////////////////////////////////////////
 using fd = asio::posix::stream_descriptor;
+class queue;
 
 // request current state data
-void request_data(fd&);
+void request_data(queue&);
 
 // set PS LED state
-void led_state(fd&, led::color, state);
+void led_state(queue&, led::color, state);
 
 // set backlight/LED flash period
-void period(fd&, byte);
+void period(queue&, byte);
 
 // set backlight state
-void light_state(fd&, byte columns, index, light::bank, state);
+void light_state(queue&, byte columns, index, light::bank, state);
 
 // turn on/off rows of backlights
-void light_on(fd&, light::bank, rows);
+void light_on(queue&, light::bank, rows);
 
 // turn on/off PS LEDs
-void leds_on(fd&, leds::color);
+void leds_on(queue&, leds::color);
 
 // set backlight intensity
-void level(fd&, byte bank_1, byte bank_2);
+void level(queue&, byte bank_1, byte bank_2);
 
 // set uid
-void uid(fd&, byte uid);
+void uid(queue&, byte uid);
 
 // request descriptor data
-void request_descriptor(fd&);
+void request_descriptor(queue&);
 
 ////////////////////////////////////////////////////////////////////////////////
 }
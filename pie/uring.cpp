@@ -0,0 +1,258 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2020-2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#include "uring.hpp"
+
+#include <cerrno>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <sys/eventfd.h>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace pie
+{
+
+////////////////////////////////////////////////////////////////////////////////
+namespace
+{
+
+// use current file position
+constexpr auto no_offset = static_cast<__u64>(-1);
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uring::uring(asio::io_context& io, unsigned entries) :
+    io_{ io }, wake_{ io }
+{
+    if(auto e = ::io_uring_queue_init(entries, &ring_, 0)) throw std::system_error{
+        std::error_code{ -e, std::generic_category() }, "Can't create io_uring"
+    };
+
+    auto fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(fd == -1 || ::io_uring_register_eventfd(&ring_, fd))
+    {
+        std::error_code ec{ errno, std::generic_category() };
+        ::io_uring_queue_exit(&ring_);
+        throw std::system_error{ ec, "Can't register eventfd" };
+    }
+    wake_.assign(fd);
+
+    sched_wait();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uring::~uring()
+{
+    ::io_uring_queue_exit(&ring_);
+    for(auto o : ops_) delete o;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void uring::read(int fd, asio::mutable_buffer buf, io_handler cb)
+{
+    auto& o = reads_[fd];
+    if(!o || o->pending)
+    {
+        o = new op{ fd, nullptr, { }, { } };
+        ops_.insert(o);
+    }
+
+    o->cb = std::move(cb);
+    o->out = buf;
+    if(o->data.size() < buf.size()) o->data.resize(buf.size());
+    o->done = 0;
+    o->error = 0;
+
+    auto sqe = get_sqe();
+    ::io_uring_prep_read(sqe, fd, o->data.data(), buf.size(), no_offset);
+    ::io_uring_sqe_set_data(sqe, o);
+    ++o->pending;
+
+    sched_submit();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void uring::write(int fd, const buffers& bufs, io_handler cb)
+{
+    auto o = new op{ fd, std::move(cb), { }, { } };
+    ops_.insert(o);
+
+    std::size_t size = 0;
+    for(auto& buf : bufs) size += buf.size();
+
+    o->data.resize(size);
+    asio::buffer_copy(asio::buffer(o->data), bufs);
+
+    // each buffer is a separate report
+    std::size_t offset = 0;
+    for(std::size_t n = 0; n < bufs.size(); ++n)
+    {
+        auto sqe = get_sqe();
+        ::io_uring_prep_write(sqe, fd, o->data.data() + offset, bufs[n].size(), no_offset);
+        ::io_uring_sqe_set_data(sqe, o);
+        if(n + 1 < bufs.size()) sqe->flags |= IOSQE_IO_LINK;
+
+        offset += bufs[n].size();
+        ++o->pending;
+    }
+
+    sched_submit();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void uring::cancel(int fd)
+{
+    reads_.erase(fd);
+
+    for(auto it = ops_.begin(); it != ops_.end(); )
+    {
+        auto o = *it;
+        if(o->fd != fd) { ++it; continue; }
+
+        if(o->cb)
+        {
+            asio::post(io_, [cb = std::move(o->cb)]{ cb(asio::error::operation_aborted, 0); });
+            o->cb = nullptr;
+        }
+
+        if(o->pending)
+        {
+            // the request itself is freed when it completes;
+            // linked writes share user_data, so cancel them one by one
+            for(std::size_t n = 0; n < o->pending; ++n)
+            {
+                auto sqe = get_sqe();
+                ::io_uring_prep_cancel(sqe, o, 0);
+                ::io_uring_sqe_set_data(sqe, nullptr);
+            }
+            ++it;
+        }
+        else
+        {
+            // idle read request, which may still be in the middle of reap()
+            it = ops_.erase(it);
+            asio::post(io_, [o = std::unique_ptr<op>{ o }]{ });
+        }
+    }
+
+    // submit right away, as the fd is about to be closed
+    ::io_uring_submit(&ring_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+io_uring_sqe* uring::get_sqe()
+{
+    auto sqe = ::io_uring_get_sqe(&ring_);
+    if(!sqe)
+    {
+        // submission queue is full - flush it
+        ::io_uring_submit(&ring_);
+        sqe = ::io_uring_get_sqe(&ring_);
+    }
+    if(!sqe) throw std::runtime_error{ "io_uring submission queue is full" };
+    return sqe;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void uring::sched_submit()
+{
+    if(!posted_)
+    {
+        posted_ = true;
+        asio::post(io_, [this]{ posted_ = false; ::io_uring_submit(&ring_); });
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void uring::sched_wait()
+{
+    wake_.async_read_some(asio::buffer(&count_, sizeof(count_)), [this](const asio::error_code& ec, std::size_t)
+    {
+        if(ec) return;
+
+        reap();
+        sched_wait();
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void uring::reap()
+{
+    std::vector<op*> done;
+
+    io_uring_cqe* cqe;
+    unsigned head, n = 0;
+    io_uring_for_each_cqe(&ring_, head, cqe)
+    {
+        ++n;
+        auto o = static_cast<op*>(::io_uring_cqe_get_data(cqe));
+        if(!o) continue; // cancel request
+
+        if(cqe->res < 0)
+        {
+            if(!o->error) o->error = -cqe->res;
+        }
+        else o->done += cqe->res;
+
+        if(--o->pending == 0) done.push_back(o);
+    }
+    ::io_uring_cq_advance(&ring_, n);
+
+    // take ownership of one-off requests first, as handlers may throw
+    std::vector<std::unique_ptr<op>> owned;
+    for(auto o : done)
+        if(!reused(o))
+        {
+            ops_.erase(o);
+            owned.emplace_back(o);
+        }
+
+    for(auto o : done)
+    {
+        if(!o->cb) continue; // abandoned
+
+        asio::error_code ec;
+        if(o->error == ECANCELED)
+            ec = asio::error::operation_aborted;
+        else if(o->error)
+            ec = asio::error_code{ o->error, asio::error::get_system_category() };
+
+        auto n = o->done;
+        if(!ec && o->out.size()) n = asio::buffer_copy(o->out, asio::buffer(o->data.data(), n));
+
+        // handler may post the next read on the same request
+        auto cb = std::move(o->cb);
+        o->cb = nullptr;
+        cb(ec, n);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool uring::reused(op* o) const
+{
+    auto it = reads_.find(o->fd);
+    return it != reads_.end() && it->second == o;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uring_hidraw::uring_hidraw(uring& ring, const fs::path& path) :
+    hidraw{ ring.io(), path }, ring_{ ring }
+{ }
+
+////////////////////////////////////////////////////////////////////////////////
+void uring_hidraw::close()
+{
+    if(is_open()) ring_.cancel(fd_.native_handle());
+    hidraw::close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}
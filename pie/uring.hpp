@@ -0,0 +1,112 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2020-2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#ifndef PIE_URING_HPP
+#define PIE_URING_HPP
+
+////////////////////////////////////////////////////////////////////////////////
+#include "transport.hpp"
+#include "types.hpp"
+
+#include <asio.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <liburing.h>
+
+namespace fs = std::filesystem;
+
+////////////////////////////////////////////////////////////////////////////////
+namespace pie
+{
+
+////////////////////////////////////////////////////////////////////////////////
+// io_uring instance shared by all keypads on the io_context.
+//
+// Completions are signalled through an eventfd watched by the io_context and
+// are reaped in batches. Requests made while handling them (or anything else
+// on the io_context) are submitted to the kernel together with one system
+// call.
+//
+// Each request owns its data, so that it can be safely abandoned when the
+// transport is closed. Reads are always posted, so the read request (and its
+// buffer) is allocated once per fd and re-used.
+//
+class uring
+{
+public:
+    explicit uring(asio::io_context&, unsigned entries = 256);
+    ~uring();
+
+    uring(const uring&) = delete;
+    uring& operator=(const uring&) = delete;
+
+    auto& io() { return io_; }
+
+    // read one report into buf
+    void read(int fd, asio::mutable_buffer buf, io_handler);
+
+    // write reports in order as linked requests
+    void write(int fd, const buffers&, io_handler);
+
+    // abort all pending requests on fd
+    void cancel(int fd);
+
+private:
+    asio::io_context& io_;
+    io_uring ring_;
+
+    struct op
+    {
+        int fd;
+        io_handler cb;
+        asio::mutable_buffer out; // where to copy read data
+        std::vector<char> data;
+
+        std::size_t pending = 0, done = 0;
+        int error = 0;
+    };
+    std::unordered_set<op*> ops_;
+    std::unordered_map<int, op*> reads_;
+    bool reused(op*) const;
+
+    io_uring_sqe* get_sqe();
+    bool posted_ = false;
+    void sched_submit();
+
+    asio::posix::stream_descriptor wake_;
+    std::uint64_t count_;
+    void sched_wait();
+    void reap();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Transport over a hidraw device node using io_uring.
+//
+class uring_hidraw : public hidraw
+{
+public:
+    uring_hidraw(uring&, const fs::path&);
+
+    void async_read(asio::mutable_buffer buf, io_handler cb) override { ring_.read(fd_.native_handle(), buf, std::move(cb)); }
+    void async_write(const buffers& bufs, io_handler cb) override { ring_.write(fd_.native_handle(), bufs, std::move(cb)); }
+
+    void close() override;
+
+private:
+    uring& ring_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -0,0 +1,156 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#include "pgm/args.hpp"
+#include "src/journal.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+#if !defined(VERSION)
+#  define VERSION "0"
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+namespace
+{
+
+using namespace src;
+
+auto read_journal(const fs::path& path)
+{
+    std::ifstream fs{ path, std::ios::binary };
+    if(!fs) throw std::runtime_error{ "Can't open " + path.string() };
+
+    jnl::header hdr;
+    if(!fs.read(reinterpret_cast<char*>(&hdr), sizeof(hdr))
+        || std::memcmp(hdr.magic, jnl::magic, sizeof(hdr.magic))
+        || hdr.version != jnl::version
+        // don't trust the header of a truncated or corrupt file
+        || std::filesystem::file_size(path) != sizeof(hdr) + std::uintmax_t{ hdr.size } * sizeof(jnl::record)
+    ) throw std::runtime_error{ "Invalid journal " + path.string() };
+
+    std::vector<jnl::record> records(hdr.size);
+    fs.read(reinterpret_cast<char*>(records.data()), records.size() * sizeof(jnl::record));
+    records.resize(fs.gcount() / sizeof(jnl::record));
+
+    records.erase(std::remove_if(records.begin(), records.end(),
+        [](auto& rec){ return rec.seq == 0; }), records.end()
+    );
+    std::sort(records.begin(), records.end(), [](auto& x, auto& y){ return x.seq < y.seq; });
+
+    return records;
+}
+
+const char* kinds[] = { "press", "release", "long-press", "repeat", "jog", "shuttle" };
+const char* actions[] = { "send", "drop", "none" };
+const char* results[] = { "", "ok", "failed" };
+
+template<typename T, std::size_t N>
+auto name(const T (&names)[N], std::size_t n) { return n < N ? names[n] : "?"; }
+
+void print(const jnl::record& rec)
+{
+    auto sec = static_cast<std::time_t>(rec.time / 1000000000);
+    auto us = rec.time % 1000000000 / 1000;
+
+    std::tm tm;
+    ::localtime_r(&sec, &tm);
+
+    char time[32];
+    std::strftime(time, sizeof(time), "%Y-%m-%d %H:%M:%S", &tm);
+
+    std::cout << rec.seq << " " << time << "." << std::setw(6) << std::setfill('0') << us << std::setfill(' ')
+              << " uid=" << static_cast<int>(rec.uid) << " " << name(kinds, rec.kind);
+
+    if(rec.kind == jnl::jog || rec.kind == jnl::shuttle)
+        std::cout << " value=" << rec.value;
+    else std::cout << " button=" << static_cast<int>(rec.idx);
+
+    std::cout << " " << name(actions, rec.action);
+    if(rec.action == jnl::send) std::cout << " " << name(results, rec.result);
+    std::cout << "\n";
+}
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char* argv[])
+try
+{
+    auto name = fs::path{ argv[0] }.filename();
+
+    pgm::args args
+    {{
+        { "-n", "--last", "N",  "Print only last <N> events."      },
+        { "-h", "--help",       "Print this help screen and exit." },
+        { "-v", "--version",    "Show version number and exit."    },
+
+        { "path",               "Path to a journal file."          },
+    }};
+
+    // delay exception handling to process --help and --version
+    std::exception_ptr ep;
+    try { args.parse(argc, argv); }
+    catch(...) { ep = std::current_exception(); }
+
+    if(args["--help"])
+    {
+        std::cout << "\n" << args.usage(name) << "\n" << std::endl;
+    }
+    else if(args["--version"])
+    {
+        std::cout << name.string() << " version " << VERSION << std::endl;
+    }
+    else if(ep)
+    {
+        std::rethrow_exception(ep);
+    }
+    else
+    {
+        auto records = read_journal(args["path"].value());
+
+        auto begin = records.begin();
+        if(args["--last"])
+        {
+            auto s = args["--last"].value();
+            char* end;
+            auto ul = std::strtoul(s.data(), &end, 0);
+
+            if(end != (s.data() + s.size())) throw pgm::invalid_argument{ "Invalid number", s };
+            if(ul < records.size()) begin = records.end() - ul;
+        }
+
+        std::for_each(begin, records.end(), print);
+        std::cout << std::flush;
+    }
+
+    return 0;
+}
+catch(std::exception& e)
+{
+    std::cerr << e.what() << std::endl;
+    return 1;
+}
+catch(...)
+{
+    std::cerr << "???" << std::endl;
+    return 1;
+}
@@ -0,0 +1,249 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#include "control.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <variant>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace src
+{
+
+////////////////////////////////////////////////////////////////////////////////
+namespace
+{
+
+using arg = std::variant<std::int32_t, float, std::string>;
+
+std::uint32_t to_uint32(const char* p)
+{
+    auto u = reinterpret_cast<const unsigned char*>(p);
+    return std::uint32_t{ u[0] } << 24 | std::uint32_t{ u[1] } << 16 | std::uint32_t{ u[2] } << 8 | u[3];
+}
+
+// read null-terminated string padded to 4 bytes
+const char* read_string(const char* p, const char* end, std::string& s)
+{
+    auto z = static_cast<const char*>(std::memchr(p, '\0', end - p));
+    if(!z) return nullptr;
+
+    s.assign(p, z);
+    p += (z - p) / 4 * 4 + 4;
+    return p <= end ? p : nullptr;
+}
+
+// read arguments with supported types, stop at the first unknown one
+auto read_args(const char* types, const char* p, const char* end)
+{
+    std::vector<arg> args;
+    for(; *types; ++types) switch(*types)
+    {
+    case 'i':
+        if(end - p < 4) return args;
+        args.push_back(static_cast<std::int32_t>(to_uint32(p)));
+        p += 4;
+        break;
+
+    case 'f':
+        {
+            if(end - p < 4) return args;
+            auto u = to_uint32(p);
+            float f;
+            std::memcpy(&f, &u, sizeof(f));
+            args.push_back(f);
+            p += 4;
+        }
+        break;
+
+    case 's': case 'S':
+        {
+            std::string s;
+            if(!(p = read_string(p, end, s))) return args;
+            args.push_back(std::move(s));
+        }
+        break;
+
+    case 'T': args.push_back(std::int32_t{ 1 }); break;
+    case 'F': args.push_back(std::int32_t{ 0 }); break;
+
+    default: return args;
+    }
+    return args;
+}
+
+std::optional<pie::state> to_state(const arg& a)
+{
+    if(auto s = std::get_if<std::string>(&a))
+    {
+        if(*s == "on") return pie::on;
+        if(*s == "off") return pie::off;
+        if(*s == "flash") return pie::flash;
+    }
+    else if(auto f = std::get_if<float>(&a))
+    {
+        // range check before the cast (also rejects NaN and inf)
+        if(*f >= pie::off && *f <= pie::flash) return static_cast<pie::state>(static_cast<int>(*f));
+    }
+    else
+    {
+        auto n = std::get<std::int32_t>(a);
+        if(n >= pie::off && n <= pie::flash) return static_cast<pie::state>(n);
+    }
+    return { };
+}
+
+std::optional<pie::byte> to_byte(const arg& a)
+{
+    if(auto i = std::get_if<std::int32_t>(&a))
+    {
+        if(*i >= 0 && *i <= UINT8_MAX) return static_cast<pie::byte>(*i);
+    }
+    else if(auto f = std::get_if<float>(&a))
+    {
+        // range check before the cast (also rejects NaN and inf)
+        if(*f >= 0 && *f <= UINT8_MAX) return static_cast<pie::byte>(*f);
+    }
+    return { };
+}
+
+// split address into parts
+auto split(const std::string& address)
+{
+    std::vector<std::string> parts;
+    for(std::size_t p = 1, q; p <= address.size(); p = q + 1)
+    {
+        q = address.find('/', p);
+        if(q == std::string::npos) q = address.size();
+        parts.push_back(address.substr(p, q - p));
+    }
+    return parts;
+}
+
+std::optional<int> to_num(const std::string& s, int max)
+{
+    char* end;
+    auto n = std::strtol(s.data(), &end, 10);
+    if(s.size() && !*end && n >= 0 && n <= max) return n;
+    return { };
+}
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+control::control(asio::io_context& io, const asio::ip::udp::endpoint& ep) :
+    socket_{ io, ep }
+{
+    socket_.non_blocking(true);
+    sched_recv();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void control::sched_recv()
+{
+    socket_.async_wait(asio::ip::udp::socket::wait_read, [this](const asio::error_code& ec){ recv_data(ec); });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void control::recv_data(const asio::error_code& ec)
+{
+    if(ec) return;
+
+    // drain the socket before going back to the event loop
+    for(;;)
+    {
+        asio::error_code rec;
+        auto n = socket_.receive(asio::buffer(data_), 0, rec);
+        if(rec) break;
+
+        parse_packet(data_, n);
+    }
+
+    sched_recv();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void control::parse_packet(const char* p, std::size_t n)
+{
+    static constexpr char bundle[] = "#bundle";
+    if(n >= 16 && !std::memcmp(p, bundle, sizeof(bundle)))
+    {
+        // skip #bundle and time tag
+        auto end = p + n;
+        for(p += 16; end - p >= 4; )
+        {
+            std::size_t size = to_uint32(p);
+            p += 4;
+            if(size > static_cast<std::size_t>(end - p)) break;
+
+            parse_packet(p, size);
+            p += size;
+        }
+    }
+    else parse_message(p, n);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void control::parse_message(const char* p, std::size_t n)
+{
+    auto end = p + n;
+
+    std::string address, types;
+    if(!(p = read_string(p, end, address)) || address.empty() || address[0] != '/') return;
+
+    // type tag string is optional in older implementations
+    if(p < end && *p == ',')
+    {
+        if(!(p = read_string(p, end, types))) return;
+        dispatch(address, types.data() + 1, p, end);
+    }
+    else dispatch(address, "", p, end);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void control::dispatch(const std::string& address, const char* types, const char* p, const char* end)
+{
+    auto parts = split(address);
+    if(parts.size() < 4 || parts[0] != "remote" || parts[1] != "pie") return;
+
+    auto uid = to_num(parts[2], UINT8_MAX);
+    if(!uid) return;
+
+    auto args = read_args(types, p, end);
+    if(args.empty()) return;
+
+    // /remote/pie/<uid>/level <bank_1> [<bank_2>]
+    if(parts.size() == 4 && parts[3] == "level")
+    {
+        auto bank_1 = to_byte(args[0]);
+        auto bank_2 = args.size() > 1 ? to_byte(args[1]) : bank_1;
+        if(bank_1 && bank_2 && vcall_) vcall_(*uid, *bank_1, *bank_2);
+    }
+
+    // /remote/pie/<uid>/<button>/led <state>
+    else if(parts.size() == 5 && parts[4] == "led")
+    {
+        auto state = to_state(args[0]);
+        if(!state) return;
+
+        if(parts[3] == "ps")
+        {
+            if(lcall_) lcall_(*uid, pie::ps, *state);
+        }
+        else if(auto idx = to_num(parts[3], pie::none - 1))
+        {
+            if(lcall_) lcall_(*uid, *idx, *state);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}
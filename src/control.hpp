@@ -0,0 +1,65 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#ifndef SRC_CONTROL_HPP
+#define SRC_CONTROL_HPP
+
+////////////////////////////////////////////////////////////////////////////////
+#include "pie/types.hpp"
+
+#include <asio.hpp>
+#include <cstddef>
+#include <functional>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace src
+{
+
+////////////////////////////////////////////////////////////////////////////////
+// idx is ps for the PS LED
+using light_callback = std::function<void (pie::byte uid, pie::index, pie::state)>;
+using level_callback = std::function<void (pie::byte uid, pie::byte bank_1, pie::byte bank_2)>;
+
+////////////////////////////////////////////////////////////////////////////////
+// Receives OSC LED commands on a UDP socket:
+//
+//   /remote/pie/<uid>/<button>/led on|off|flash
+//   /remote/pie/<uid>/ps/led on|off|flash
+//   /remote/pie/<uid>/level <bank_1> [<bank_2>]
+//
+// Bundles are unpacked. All datagrams that are already waiting are processed
+// in one go, so that the resulting LED commands can be merged by the queue.
+//
+class control
+{
+public:
+    control(asio::io_context&, const asio::ip::udp::endpoint&);
+
+    void on_light(light_callback cb) { lcall_ = std::move(cb); }
+    void on_level(level_callback cb) { vcall_ = std::move(cb); }
+
+private:
+    asio::ip::udp::socket socket_;
+
+    light_callback lcall_;
+    level_callback vcall_;
+
+    char data_[65536];
+    void sched_recv();
+    void recv_data(const asio::error_code&);
+
+    void parse_packet(const char*, std::size_t);
+    void parse_message(const char*, std::size_t);
+    void dispatch(const std::string& address, const char* types, const char* args, const char* end);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif
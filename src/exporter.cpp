@@ -0,0 +1,92 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#include "exporter.hpp"
+
+#include <chrono>
+#include <sstream>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace src
+{
+
+////////////////////////////////////////////////////////////////////////////////
+namespace
+{
+
+constexpr std::size_t max_request = 8192;
+constexpr std::chrono::seconds timeout{ 1 };
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+exporter::exporter(asio::io_context& io, const asio::ip::tcp::endpoint& ep, metrics_callback cb) :
+    acceptor_{ io, ep }, socket_{ io }, timer_{ io }, call_{ std::move(cb) }
+{
+    sched_accept();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void exporter::sched_accept()
+{
+    acceptor_.async_accept(socket_, [this](const asio::error_code& ec)
+    {
+        if(ec == asio::error::operation_aborted) return;
+        if(ec) return sched_accept();
+
+        request_.clear();
+        timer_.expires_after(timeout);
+        timer_.async_wait([this](const asio::error_code& ec){ if(!ec) socket_.close(); });
+
+        sched_read();
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void exporter::sched_read()
+{
+    socket_.async_read_some(asio::buffer(data_), [this](const asio::error_code& ec, std::size_t n)
+    {
+        if(ec) return done();
+
+        request_.append(data_, n);
+        if(request_.find("\r\n\r\n") != std::string::npos) respond();
+
+        else if(request_.size() < max_request) sched_read();
+        else done();
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void exporter::respond()
+{
+    std::ostringstream body;
+    if(call_) call_(body);
+
+    auto s = body.str();
+    response_ = "HTTP/1.0 200 OK\r\n"
+                "Content-Type: text/plain; version=0.0.4\r\n"
+                "Content-Length: " + std::to_string(s.size()) + "\r\n"
+                "Connection: close\r\n"
+                "\r\n" + s;
+
+    asio::async_write(socket_, asio::buffer(response_), [this](const asio::error_code&, std::size_t){ done(); });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void exporter::done()
+{
+    asio::error_code ec;
+    socket_.shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+    socket_.close(ec);
+
+    timer_.cancel();
+    sched_accept();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,56 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#ifndef SRC_EXPORTER_HPP
+#define SRC_EXPORTER_HPP
+
+////////////////////////////////////////////////////////////////////////////////
+#include <asio.hpp>
+#include <functional>
+#include <iosfwd>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace src
+{
+
+////////////////////////////////////////////////////////////////////////////////
+using metrics_callback = std::function<void (std::ostream&)>;
+
+////////////////////////////////////////////////////////////////////////////////
+// Minimal HTTP server for Prometheus scrapes.
+//
+// Answers any request with the metrics in text format and closes the
+// connection. Clients are served one at a time; a client that doesn't send
+// its request within a second is disconnected.
+//
+class exporter
+{
+public:
+    exporter(asio::io_context&, const asio::ip::tcp::endpoint&, metrics_callback);
+
+private:
+    asio::ip::tcp::acceptor acceptor_;
+    asio::ip::tcp::socket socket_;
+    asio::steady_timer timer_;
+
+    metrics_callback call_;
+
+    char data_[1024];
+    std::string request_, response_;
+
+    void sched_accept();
+    void sched_read();
+    void respond();
+    void done();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif
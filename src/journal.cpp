@@ -0,0 +1,119 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#include "journal.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace src
+{
+
+////////////////////////////////////////////////////////////////////////////////
+namespace
+{
+
+[[noreturn]] void throw_errno(const std::string& msg)
+{
+    throw std::system_error{ std::error_code{ errno, std::generic_category() }, msg };
+}
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+journal::journal(const fs::path& path, std::size_t size) :
+    map_size_{ sizeof(jnl::header) + size * sizeof(jnl::record) }
+{
+    if(!size) throw std::invalid_argument{ "Invalid journal size" };
+
+    auto fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if(fd < 0) throw_errno("Can't open journal " + path.string());
+
+    // re-use existing journal if it has the same layout
+    jnl::header hdr{ };
+    struct stat st;
+    auto keep = ::fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) == map_size_
+        && ::pread(fd, &hdr, sizeof(hdr), 0) == sizeof(hdr)
+        && !std::memcmp(hdr.magic, jnl::magic, sizeof(hdr.magic))
+        && hdr.version == jnl::version && hdr.size == size;
+
+    if(!keep && (::ftruncate(fd, 0) || ::ftruncate(fd, map_size_)))
+    {
+        ::close(fd);
+        throw_errno("Can't resize journal " + path.string());
+    }
+
+    // populate to avoid page faults on the event path
+    data_ = ::mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if(data_ == MAP_FAILED) throw_errno("Can't map journal " + path.string());
+
+    header_ = static_cast<jnl::header*>(data_);
+    records_ = reinterpret_cast<jnl::record*>(header_ + 1);
+
+    if(!keep)
+    {
+        std::memcpy(header_->magic, jnl::magic, sizeof(jnl::magic));
+        header_->version = jnl::version;
+        header_->size = size;
+        header_->next = 1;
+    }
+    pending_ = header_->next;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+journal::~journal() { ::munmap(data_, map_size_); }
+
+////////////////////////////////////////////////////////////////////////////////
+void journal::add(jnl::kind kind, pie::byte uid, pie::index idx, int value, const pie::timestamp& time, jnl::action action)
+{
+    using namespace std::chrono;
+
+    auto seq = header_->next++;
+    auto& rec = records_[seq % header_->size];
+
+    // invalidate first, so that a half-written record is skipped
+    rec.seq = 0;
+    std::atomic_signal_fence(std::memory_order_release);
+
+    rec.time = duration_cast<nanoseconds>(time.real.time_since_epoch()).count();
+    rec.value = value;
+    rec.uid = uid;
+    rec.idx = idx;
+    rec.kind = kind;
+    rec.action = action;
+    rec.result = jnl::pending;
+
+    std::atomic_signal_fence(std::memory_order_release);
+    rec.seq = seq;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void journal::done(bool ok)
+{
+    auto next = header_->next;
+    if(next - pending_ > header_->size) pending_ = next - header_->size;
+
+    for(; pending_ < next; ++pending_)
+    {
+        auto& rec = records_[pending_ % header_->size];
+        if(rec.action == jnl::send) rec.result = ok ? jnl::ok : jnl::failed;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}
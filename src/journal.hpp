@@ -0,0 +1,109 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#ifndef SRC_JOURNAL_HPP
+#define SRC_JOURNAL_HPP
+
+////////////////////////////////////////////////////////////////////////////////
+#include "pie/types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+////////////////////////////////////////////////////////////////////////////////
+namespace src
+{
+
+////////////////////////////////////////////////////////////////////////////////
+// Journal file format (native byte order):
+//
+// jnl::header followed by a ring of jnl::record's. Records are numbered
+// starting from 1; a record with seq == 0 is empty.
+//
+namespace jnl
+{
+
+constexpr char magic[8] = { 'B', 'A', 'K', 'E', 'R', 'J', 'N', 'L' };
+constexpr std::uint32_t version = 1;
+
+enum kind : pie::byte { press, release, long_press, repeat, jog, shuttle };
+
+// what was done with the event
+enum action : pie::byte
+{
+    send, // OSC message was queued for sending
+    drop, // dropped by the rate limiter
+    none, // no OSC message configured
+};
+
+// outcome of sending
+enum result : pie::byte { pending, ok, failed };
+
+struct header
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t size; // number of records
+    std::uint64_t next; // seq of the next record
+    char reserved[40];
+};
+static_assert(sizeof(header) == 64);
+
+struct record
+{
+    std::uint64_t seq;
+    std::int64_t time;  // ns since epoch when the report was received
+    std::int32_t value; // jog delta or shuttle position
+    pie::byte uid;
+    pie::index idx;
+    pie::byte kind;
+    pie::byte action;
+    pie::byte result;
+    pie::byte reserved[7];
+};
+static_assert(sizeof(record) == 32);
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Fixed-size ring buffer of events backed by a memory-mapped file.
+//
+// Adding records only writes to the mapped memory, so the journal can be
+// left on at all times. The file is kept across restarts and crashes.
+//
+class journal
+{
+public:
+    journal(const fs::path&, std::size_t size);
+    ~journal();
+
+    journal(const journal&) = delete;
+    journal& operator=(const journal&) = delete;
+
+    void add(jnl::kind, pie::byte uid, pie::index, int value, const pie::timestamp&, jnl::action);
+
+    // set result of records added since the last call
+    void done(bool ok);
+
+private:
+    void* data_;
+    std::size_t map_size_;
+
+    jnl::header* header_;
+    jnl::record* records_;
+
+    std::uint64_t pending_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif
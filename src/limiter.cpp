@@ -0,0 +1,91 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#include "limiter.hpp"
+#include "pie/metrics.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace src
+{
+
+////////////////////////////////////////////////////////////////////////////////
+std::optional<limits> to_limits(const std::string& s)
+{
+    char* end;
+    limits l;
+
+    l.rate = std::strtod(s.data(), &end);
+    if(end == s.data() || l.rate < 0) return { };
+
+    // default burst is one second worth of events,
+    // but at least one, or no event would ever pass
+    l.burst = std::max(1.0, l.rate);
+    if(*end == '/')
+    {
+        auto p = end + 1;
+        l.burst = std::strtod(p, &end);
+        if(end == p || l.burst < 1) return { };
+    }
+    if(*end) return { };
+
+    return l;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool bucket::take(clock::time_point now)
+{
+    if(limits_.rate <= 0) return true;
+
+    using seconds = std::chrono::duration<double>;
+    tokens_ = std::min(limits_.burst, tokens_ + seconds{ now - last_ }.count() * limits_.rate);
+    last_ = now;
+
+    if(tokens_ < 1) return false;
+
+    tokens_ -= 1;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+limiter::limiter(const limits& button, bucket* global) : global_{ global }
+{
+    buckets_.fill(bucket{ button });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool limiter::press(pie::index idx, bucket::clock::time_point now)
+{
+    if(buckets_[idx].take(now) && (!global_ || global_->take(now)))
+    {
+        limited_ = 0;
+        return true;
+    }
+
+    dropped_.insert(idx);
+    ++count_;
+    ++pie::metrics().dropped;
+    if(!limited_) limited_ = 1;
+
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool limiter::release(pie::index idx)
+{
+    if(!dropped_.count(idx)) return true;
+
+    dropped_.erase(idx);
+    ++count_;
+    ++pie::metrics().dropped;
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,90 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#ifndef SRC_LIMITER_HPP
+#define SRC_LIMITER_HPP
+
+////////////////////////////////////////////////////////////////////////////////
+#include "pie/index_set.hpp"
+#include "pie/types.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace src
+{
+
+////////////////////////////////////////////////////////////////////////////////
+// Token bucket rate limit
+struct limits
+{
+    double rate = 0;  // events per second (0 = unlimited)
+    double burst = 0; // max number of events at once
+};
+
+// parse rate[/burst]
+std::optional<limits> to_limits(const std::string&);
+
+////////////////////////////////////////////////////////////////////////////////
+class bucket
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    bucket() = default;
+    explicit bucket(const limits& l) : limits_{ l }, tokens_{ l.burst } { }
+
+    // take one token, if available
+    bool take(clock::time_point);
+
+private:
+    limits limits_;
+    double tokens_ = 0;
+    clock::time_point last_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Rate limits press events of a remote per button and globally.
+//
+// When a press is dropped, its release (and any long-press or repeat events in
+// between) are dropped as well, so that the receiver never sees an unbalanced
+// press or release.
+//
+class limiter
+{
+public:
+    limiter(const limits& button, bucket* global);
+
+    // return true if the event should be sent
+    bool press(pie::index, bucket::clock::time_point);
+    bool release(pie::index);
+    bool other(pie::index idx) const { return !dropped_.count(idx); }
+
+    // number of dropped events
+    auto dropped() const { return count_; }
+
+    // return true once each time events start being dropped
+    bool warn() { auto w = limited_ == 1; if(w) limited_ = 2; return w; }
+
+private:
+    std::array<bucket, 256> buckets_;
+    bucket* global_;
+
+    pie::index_set dropped_;
+    std::size_t count_ = 0;
+    int limited_ = 0; // 0 = no, 1 = just now, 2 = reported
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif
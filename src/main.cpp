@@ -6,15 +6,45 @@
 
 ////////////////////////////////////////////////////////////////////////////////
 #include "pgm/args.hpp"
+#include "pie/latency.hpp"
+#include "pie/metrics.hpp"
+#include "pie/record.hpp"
+#include "pie/rt_hidraw.hpp"
+#if defined(BAKER_URING)
+#  include "pie/uring.hpp"
+#endif
+#include "src/control.hpp"
+#include "src/exporter.hpp"
+#include "src/journal.hpp"
+#include "src/limiter.hpp"
 #include "src/remote.hpp"
+#include "src/scan.hpp"
+#include "src/sender.hpp"
+#include "src/snapshot.hpp"
+#include "src/stream.hpp"
+#include "src/watcher.hpp"
 #include "util.hpp"
 
+#include <algorithm>
 #include <asio.hpp>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
 #include <exception>
 #include <filesystem>
+#include <functional>
 #include <iostream>
-#include <osc++.hpp>
+#include <map>
+#include <memory>
+#include <optional>
+#include <stdexcept>
 #include <string>
+#include <system_error>
+#include <vector>
+
+#include <sys/mman.h> // mlockall
 
 namespace fs = std::filesystem;
 
@@ -26,10 +56,10 @@ namespace fs = std::filesystem;
 auto to_address(const std::string& s)
 {
     asio::error_code ec;
-    auto address = asio::ip::make_address(s, ec);
+    auto address = asio::ip::make_address_v4(s, ec);
 
     if(!ec) return address;
-    else throw pgm::invalid_argument{ "Invalid IP address", s };
+    else throw pgm::invalid_argument{ "Invalid IPv4 address", s };
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -43,6 +73,28 @@ auto to_port(const std::string& s)
     else throw pgm::invalid_argument{ "Invalid port number", s };
 }
 
+////////////////////////////////////////////////////////////////////////////////
+auto to_num(const std::string& s)
+{
+    char* end;
+    auto n = std::strtol(s.data(), &end, 0);
+
+    if(n >= 0 && n <= INT16_MAX && end == (s.data() + s.size()))
+        return static_cast<int>(n);
+    else throw pgm::invalid_argument{ "Invalid number", s };
+}
+
+////////////////////////////////////////////////////////////////////////////////
+auto to_size(const std::string& s)
+{
+    char* end;
+    auto ul = std::strtoul(s.data(), &end, 0);
+
+    if(ul <= UINT32_MAX && end == (s.data() + s.size()))
+        return static_cast<std::size_t>(ul);
+    else throw pgm::invalid_argument{ "Invalid size", s };
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 int main(int argc, char* argv[])
 try
@@ -51,18 +103,67 @@ try
 
     std::string def_address = "127.0.0.1";
     std::string def_port = "6260";
+    std::string def_listen_port = "6261";
+    std::string def_metrics_port = "9260";
+    std::string def_rate_limit = "0";
+    std::string def_button_limit = "0";
     auto def_conf = "/etc" / name;
+    auto def_journal = "/var/lib" / name;
+    auto def_state = "/var/lib" / name;
+    std::string def_journal_size = "65536";
 
     pgm::args args
     {{
         { "-a", "--address", "addr",  "Specify OSC server IP address to send messages to.\n"
                                       "Default: " + def_address + "."    },
         { "-p", "--port", "N",        "Specify OSC server port number. Default: " + def_port + "." },
+        { "-d", "--dest", "addr[:N]", pgm::mul,
+                                      "Send OSC messages to additional server <addr> on port <N>.\n"
+                                      "Can be specified multiple times. When used, --address and --port\n"
+                                      "are only used if specified explicitly." },
+        { "-s", "--tcp", "addr[:N]", pgm::mul,
+                                      "Send OSC messages to server <addr> on port <N> over TCP.\n"
+                                      "Can be specified multiple times." },
+        { "-t", "--timetag",          "Always send OSC bundles with the time tag set to the time\n"
+                                      "when the keypad report was received." },
+        { "-l", "--listen", "addr[:N]",
+                                      "Listen for OSC LED commands on <addr> port <N>.\n"
+                                      "Default port: " + def_listen_port + "." },
+        { "-x", "--metrics", "addr[:N]",
+                                      "Serve Prometheus metrics on <addr> port <N>.\n"
+                                      "Default port: " + def_metrics_port + "." },
+        { "-L", "--rate-limit", "N[/B]",
+                                      "Send at most <N> press events per second from all devices,\n"
+                                      "in bursts of up to <B> (default: <N> or 1).\n"
+                                      "Default: " + def_rate_limit + " (no limit)." },
+        { "-b", "--button-limit", "N[/B]",
+                                      "Send at most <N> press events per second from each button,\n"
+                                      "in bursts of up to <B> (default: <N> or 1).\n"
+                                      "Default: " + def_button_limit + " (no limit)." },
         { "-c", "--conf-dir", "path", "Specify path to configuration directory. Default: " + def_conf.string() + "." },
+        { "-j", "--journal", "dir",   "Log all events into <dir>/<device>.journal file.\n"
+                                      "Default: " + def_journal.string() + " (not used with --replay)." },
+        { "-J", "--journal-size", "N",
+                                      "Keep last <N> events in the journal. Default: " + def_journal_size + ".\n"
+                                      "Use 0 to disable the journal." },
+        { "-S", "--state", "dir",     "Save latched state of each device into <dir>/<uid>.state file\n"
+                                      "and restore it on startup. Default: " + def_state.string() + "\n"
+                                      "(not used with --replay)." },
+        { "-n", "--announce",         "Send press events for buttons restored from the state file." },
+        { "-A", "--all",              "Find and open all connected X-Keys devices." },
+        { "-r", "--record", "dir",    "Record all reports to/from each device into <dir>/<device>.rec file." },
+        { "-R", "--replay", "file", pgm::mul,
+                                      "Play back reports from a recording instead of a device.\n"
+                                      "Can be specified multiple times." },
+        { "-M", "--max-speed",        "Play back recordings at maximum speed." },
+        { "-T", "--rt-thread",        "Read reports from each device on a dedicated thread." },
+        { "-P", "--rt-priority", "N", "Run reader threads with SCHED_FIFO priority <N>. Implies --rt-thread." },
+        { "-C", "--rt-cpu", "N",      "Pin reader threads to CPU <N>. Implies --rt-thread." },
+        { "-m", "--mlock",            "Lock all memory to prevent page faults." },
         { "-h", "--help",             "Print this help screen and exit." },
         { "-v", "--version",          "Show version number and exit."    },
 
-        { "path",                     "Path to an X-Keys device."        },
+        { "path", pgm::opt | pgm::mul, "Path to an X-Keys device. Can be specified multiple times." },
     }};
 
     // delay exception handling to process --help and --version
@@ -84,42 +185,408 @@ try
     }
     else
     {
-        auto path = fs::path{ args["path"].value() };
+        std::vector<fs::path> paths;
+        for(auto& path : args["path"].values()) paths.emplace_back(path);
+
+        auto replay = static_cast<bool>(args["--replay"]);
+        if(replay) for(auto& path : args["--replay"].values()) paths.emplace_back(path);
+
+        auto speed = args["--max-speed"] ? pie::replayer::max : pie::replayer::original;
+
+        std::optional<fs::path> record_dir;
+        if(args["--record"]) record_dir = args["--record"].value();
+
+        std::optional<fs::path> journal_dir;
+        if(args["--journal"] || !replay) journal_dir = args["--journal"].value_or(def_journal);
+
+        auto journal_size = to_size(args["--journal-size"].value_or(def_journal_size));
+        if(!journal_size) journal_dir.reset();
+
+        std::optional<fs::path> state_dir;
+        if(args["--state"] || !replay) state_dir = args["--state"].value_or(def_state);
+
+        auto announce = static_cast<bool>(args["--announce"]);
+
+        auto rt = args["--rt-thread"] || args["--rt-priority"] || args["--rt-cpu"];
+        pie::rt_hidraw::options rt_opt;
+        if(args["--rt-priority"]) rt_opt.priority = to_num(args["--rt-priority"].value());
+        if(args["--rt-cpu"]) rt_opt.cpu = to_num(args["--rt-cpu"].value());
+
+        if(args["--mlock"] && ::mlockall(MCL_CURRENT | MCL_FUTURE)) throw std::system_error{
+            std::error_code{ errno, std::generic_category() }, "Can't lock memory"
+        };
 
-        asio::ip::udp::endpoint ep{
+        auto to_limits = [](const std::string& s)
+        {
+            if(auto l = src::to_limits(s)) return *l;
+            else throw pgm::invalid_argument{ "Invalid rate limit", s };
+        };
+        auto button_limits = to_limits(args["--button-limit"].value_or(def_button_limit));
+
+        // shared by all devices
+        src::bucket global{ to_limits(args["--rate-limit"].value_or(def_rate_limit)) };
+
+        auto all = !replay && args["--all"];
+        if(!all && paths.empty()) throw std::invalid_argument{ "No X-Keys devices specified." };
+
+        src::destinations dests;
+        // OSC messages are sent over an IPv4 socket
+        for(auto& s : args["--dest"].values())
+            if(auto ep = src::to_endpoint(s, to_port(def_port)))
+            {
+                if(ep->address().is_v6()) throw pgm::invalid_argument{ "IPv6 destinations are not supported", s };
+                dests.push_back(*ep);
+            }
+            else throw pgm::invalid_argument{ "Invalid destination", s };
+
+        std::vector<asio::ip::tcp::endpoint> tcp_dests;
+        for(auto& s : args["--tcp"].values())
+            if(auto ep = src::to_endpoint(s, to_port(def_port)))
+                tcp_dests.emplace_back(ep->address(), ep->port());
+            else throw pgm::invalid_argument{ "Invalid destination", s };
+
+        if((dests.empty() && tcp_dests.empty()) || args["--address"] || args["--port"]) dests.emplace_back(
             to_address(args["--address"].value_or(def_address)),
             to_port(args["--port"].value_or(def_port))
-        };
+        );
 
         asio::io_context io;
         asio::ip::udp::socket socket{ io };
         socket.open(asio::ip::udp::v4());
 
-        src::remote remote{ io, path };
-        std::cout << "Device info: uid=" << static_cast<int>(remote.uid()) << ", path=" << path << std::endl;
+#if defined(BAKER_URING)
+        // keypad reads and LED writes for all devices go through one ring
+        pie::uring ring{ io };
+#endif
+
+        src::sender sender{ socket };
+        sender.timetag(static_cast<bool>(args["--timetag"]));
+
+        std::vector<std::unique_ptr<src::stream>> streams;
+        for(auto& ep : tcp_dests)
+        {
+            streams.push_back(std::make_unique<src::stream>(io, ep));
+            sender.add_stream(*streams.back());
+        }
+
+        auto conf_dir = fs::path{ args["--conf-dir"].value_or(def_conf) };
 
-        auto conf_path = fs::path{ args["--conf-dir"].value_or(def_conf) } / (std::to_string(remote.uid()) + ".conf");
-        if(fs::exists(conf_path)) remote.conf_from(conf_path);
+        // one timer wheel drives timing of all buttons
+        pie::timer_wheel wheel{ io };
 
-        auto prefix = "/remote/pie/" + std::to_string(remote.uid()) + "/";
+        // all remotes share the same io_context and socket;
+        // they are moved from opening to remotes once they are ready
+        std::map<fs::path, std::unique_ptr<src::remote>> remotes, opening;
 
-        remote.on_press([&](pie::index idx)
+        auto close = [&](const fs::path& path)
         {
-            osc::message msg{ prefix + std::to_string(idx) + "/press" };
-            msg << remote.uid() << idx << "press";
+            auto& from = remotes.count(path) ? remotes : opening;
 
-            auto packet = msg.to_packet();
-            socket.send_to(asio::buffer(packet.data(), packet.size()), ep);
-        });
+            auto it = from.find(path);
+            if(it == from.end()) return;
+
+            // let aborted handlers of this remote run before destroying it
+            std::shared_ptr<src::remote> remote{ std::move(it->second) };
+            from.erase(it);
+
+            remote->close();
+            asio::post(io, [remote]{ });
+
+            if(!all && remotes.empty() && opening.empty())
+            {
+                std::cout << "No devices left - exiting." << std::endl;
+                io.stop();
+            }
+        };
 
-        remote.on_release([&](pie::index idx)
+        auto open = [&](const fs::path& path)
         {
-            osc::message msg{ prefix + std::to_string(idx) + "/release" };
-            msg << remote.uid() << idx << "release";
+            // already open (or being opened)
+            if(opening.count(path) || remotes.count(path)) return;
 
-            auto packet = msg.to_packet();
-            socket.send_to(asio::buffer(packet.data(), packet.size()), ep);
-        });
+            try
+            {
+                std::unique_ptr<pie::transport> tp;
+                if(replay)
+                {
+                    auto rp = std::make_unique<pie::replayer>(io, path, speed);
+                    rp->on_end([&, path, rp = rp.get()]
+                    {
+                        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(rp->elapsed()).count();
+                        std::cout << "Played back " << rp->reports() << " reports from " << path << " in " << ns / 1000 << " us";
+                        if(ns) std::cout << " (" << rp->reports() * 1000000000. / ns << " reports/s)";
+                        std::cout << "." << std::endl;
+
+                        close(path);
+                    });
+                    tp = std::move(rp);
+                }
+                else if(rt) tp = std::make_unique<pie::rt_hidraw>(io, path, rt_opt);
+#if defined(BAKER_URING)
+                else tp = std::make_unique<pie::uring_hidraw>(ring, path);
+#else
+                else tp = std::make_unique<pie::hidraw>(io, path);
+#endif
+
+                if(record_dir) tp = std::make_unique<pie::recorder>(
+                    std::move(tp), *record_dir / (path.filename().string() + ".rec")
+                );
+
+                // recordings are read synchronously, devices are set up
+                // concurrently on the event loop
+                auto remote = std::make_unique<src::remote>(path, std::move(tp), replay ? src::remote::sync : src::remote::async);
+
+                remote->set_timers(wheel);
+                remote->set_destinations(dests);
+                remote->set_limits(button_limits, &global);
+
+                if(journal_dir) try
+                {
+                    fs::create_directories(*journal_dir);
+                    remote->set_journal(std::make_unique<src::journal>(
+                        *journal_dir / (path.filename().string() + ".journal"), journal_size
+                    ));
+                }
+                catch(std::exception& e)
+                {
+                    std::cerr << "Journal disabled for device " << path << ": " << e.what() << std::endl;
+                }
+
+                auto rp = remote.get();
+                opening.emplace(path, std::move(remote));
+
+                rp->on_ready([&, path, rp](const asio::error_code& ec)
+                {
+                    auto it = opening.find(path);
+                    if(it == opening.end()) return; // closed in the meantime
+
+                    try
+                    {
+                        if(ec) throw std::system_error{ ec };
+
+                        auto& r = *rp;
+                        std::cout << "Device info: uid=" << static_cast<int>(r.uid()) << ", path=" << path << std::endl;
+
+                        // also builds packets for this uid
+                        r.reload(conf_dir / (std::to_string(r.uid()) + ".conf"));
+
+                        // log event to the journal and queue its packet
+                        auto queue = [&r, &sender](src::jnl::kind kind, pie::index idx, int value,
+                            const pie::timestamp& time, asio::const_buffer packet, bool pass = true)
+                        {
+                            auto action = !pass ? src::jnl::drop : packet.size() ? src::jnl::send : src::jnl::none;
+                            if(auto j = r.journal()) j->add(kind, r.uid(), idx, value, time, action);
+                            if(action == src::jnl::send) sender.add(packet);
+                        };
+
+                        r.on_press([&r, queue](const pie::event& ev)
+                        {
+                            auto pass = r.limiter().press(ev.idx, ev.time.mono);
+                            queue(src::jnl::press, ev.idx, 0, ev.time, r.packets().press(ev.idx), pass);
+
+                            if(!pass && r.limiter().warn()) std::cerr << "Rate limit reached on device " << r.path() << " - dropping events." << std::endl;
+                        });
+
+                        r.on_release([&r, queue](const pie::event& ev)
+                        {
+                            auto pass = r.limiter().release(ev.idx);
+                            queue(src::jnl::release, ev.idx, 0, ev.time, r.packets().release(ev.idx), pass);
+                        });
+
+                        r.on_long_press([&r, queue](const pie::event& ev)
+                        {
+                            auto pass = r.limiter().other(ev.idx);
+                            queue(src::jnl::long_press, ev.idx, 0, ev.time, r.packets().long_press(ev.idx), pass);
+                        });
+
+                        r.on_repeat([&r, queue](const pie::event& ev)
+                        {
+                            auto pass = r.limiter().other(ev.idx);
+                            queue(src::jnl::repeat, ev.idx, 0, ev.time, r.packets().repeat(ev.idx), pass);
+                        });
+
+                        r.on_jog([&r, queue](int delta, const pie::timestamp& time)
+                        {
+                            queue(src::jnl::jog, pie::none, delta, time, r.packets().jog(delta));
+                        });
+
+                        r.on_shuttle([&r, queue](int pos, const pie::timestamp& time)
+                        {
+                            queue(src::jnl::shuttle, pie::none, pos, time, r.packets().shuttle(pos));
+                        });
+
+                        // send events from the same report together
+                        r.on_report([&](const pie::timestamp& time)
+                        {
+                            auto ok = sender.flush(r.destinations(), time);
+                            if(auto j = r.journal()) j->done(ok);
+
+                            r.save_state();
+                        });
+
+                        if(state_dir) try
+                        {
+                            fs::create_directories(*state_dir);
+                            r.set_state_file(*state_dir / (std::to_string(r.uid()) + ".state"), announce);
+                        }
+                        catch(std::exception& e)
+                        {
+                            std::cerr << "Can't restore state of device " << path << ": " << e.what() << std::endl;
+                        }
+
+                        remotes.emplace(path, std::move(it->second));
+                        opening.erase(it);
+                    }
+                    catch(std::exception& e)
+                    {
+                        std::cerr << "Failed to open device " << path << ": " << e.what() << std::endl;
+                        close(path);
+                    }
+                });
+            }
+            catch(std::exception& e)
+            {
+                std::cerr << "Failed to open device " << path << ": " << e.what() << std::endl;
+            }
+        };
+
+        auto wanted = [&](const fs::path& path)
+        {
+            if(all) return src::is_supported(path);
+            return std::find(paths.begin(), paths.end(), path) != paths.end();
+        };
+
+        // watch for devices coming and going
+        src::watcher dev_watch{ io, "/dev", IN_CREATE | IN_DELETE,
+            [&](const std::string& name, std::uint32_t mask)
+            {
+                auto path = "/dev" / fs::path{ name };
+                if(mask & IN_DELETE)
+                {
+                    if(remotes.count(path) || opening.count(path)) std::cout << "Device " << path << " no longer exists." << std::endl;
+                    close(path);
+                }
+                else if(!remotes.count(path) && !opening.count(path) && wanted(path)) open(path);
+            }
+        };
+
+        auto reload = [&](src::remote& remote)
+        {
+            auto conf_path = conf_dir / (std::to_string(remote.uid()) + ".conf");
+            try
+            {
+                remote.reload(conf_path);
+                std::cout << "Reloaded " << conf_path << " for device " << remote.path() << "." << std::endl;
+            }
+            catch(std::exception& e)
+            {
+                std::cerr << "Failed to reload " << conf_path << ": " << e.what() << " Keeping old configuration." << std::endl;
+            }
+        };
+
+        // reload conf files as soon as they change
+        std::optional<src::watcher> conf_watch;
+        try
+        {
+            conf_watch.emplace(io, conf_dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE,
+                [&](const std::string& name, std::uint32_t)
+                {
+                    for(auto& [ _, remote ] : remotes)
+                        if(name == std::to_string(remote->uid()) + ".conf") reload(*remote);
+                }
+            );
+        }
+        catch(std::exception& e)
+        {
+            std::cerr << "Can't watch " << conf_dir << ": " << e.what() << std::endl;
+        }
+
+        // LED feedback from OSC servers
+        std::optional<src::control> control;
+        if(args["--listen"])
+        {
+            auto s = args["--listen"].value();
+            auto ep = src::to_endpoint(s, to_port(def_listen_port));
+            if(!ep) throw pgm::invalid_argument{ "Invalid address", s };
+
+            control.emplace(io, *ep);
+            control->on_light([&](pie::byte uid, pie::index idx, pie::state state)
+            {
+                for(auto& [ _, remote ] : remotes)
+                    if(remote->uid() == uid)
+                    {
+                        if(idx == pie::ps)
+                            remote->set_led(pie::led::green, state);
+                        else if(idx < remote->buttons())
+                            remote->set_light(idx, state);
+                    }
+            });
+            control->on_level([&](pie::byte uid, pie::byte bank_1, pie::byte bank_2)
+            {
+                for(auto& [ _, remote ] : remotes)
+                    if(remote->uid() == uid) remote->set_level(bank_1, bank_2);
+            });
+        }
+
+        // Prometheus metrics
+        std::optional<src::exporter> exporter;
+        if(args["--metrics"])
+        {
+            auto s = args["--metrics"].value();
+            auto ep = src::to_endpoint(s, to_port(def_metrics_port));
+            if(!ep) throw pgm::invalid_argument{ "Invalid address", s };
+
+            exporter.emplace(io, asio::ip::tcp::endpoint{ ep->address(), ep->port() }, [&](std::ostream& os)
+            {
+                std::size_t pressed = 0;
+                for(auto& [ _, remote ] : remotes) pressed += remote->pressed();
+
+                os << pie::metrics()
+                   << "# HELP baker_devices Number of open devices.\n"
+                   << "# TYPE baker_devices gauge\n"
+                   << "baker_devices " << remotes.size() << "\n"
+                   << "# HELP baker_pressed_buttons Number of currently pressed buttons.\n"
+                   << "# TYPE baker_pressed_buttons gauge\n"
+                   << "baker_pressed_buttons " << pressed << "\n";
+            });
+        }
+
+        if(all) paths = src::find_devices();
+
+        // drop duplicate paths, keeping the order
+        for(auto it = paths.begin(); it != paths.end(); )
+            if(std::find(paths.begin(), it, *it) != it) it = paths.erase(it); else ++it;
+
+        for(auto& path : paths) open(path);
+
+        if(!all && remotes.empty() && opening.empty()) throw std::runtime_error{ "No devices opened." };
+
+        // dump latency stats on SIGUSR1
+        asio::signal_set usr1{ io, SIGUSR1 };
+        std::function<void (const asio::error_code&, int)> dump_stats = [&](const asio::error_code& ec, int)
+        {
+            if(ec) return;
+
+            std::cout << "Latency stats:\n" << pie::latency();
+            std::cout << "Dropped events:\n";
+            for(auto& [ path, remote ] : remotes) std::cout << "  " << path.string() << ": " << remote->limiter().dropped() << "\n";
+            std::cout << "Dropped reports (reader thread): " << pie::metrics().rt_dropped << "\n";
+            for(auto& s : streams) std::cout << "Dropped packets (stream to " << s->endpoint() << "): " << s->dropped() << "\n";
+            std::cout << std::flush;
+            usr1.async_wait(dump_stats);
+        };
+        usr1.async_wait(dump_stats);
+
+        // reload all conf files on SIGHUP
+        asio::signal_set hup{ io, SIGHUP };
+        std::function<void (const asio::error_code&, int)> reload_all = [&](const asio::error_code& ec, int)
+        {
+            if(ec) return;
+
+            for(auto& [ _, remote ] : remotes) reload(*remote);
+            hup.async_wait(reload_all);
+        };
+        hup.async_wait(reload_all);
 
         src::on_interrupt([&](int signal)
         {
@@ -0,0 +1,121 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#include "packets.hpp"
+
+#include <cstring>
+#include <osc++.hpp>
+#include <string>
+#include <type_traits>
+
+#include <arpa/inet.h> // htonl
+
+////////////////////////////////////////////////////////////////////////////////
+namespace src
+{
+
+////////////////////////////////////////////////////////////////////////////////
+namespace
+{
+
+void replace_all(std::string& s, const std::string& from, const std::string& to)
+{
+    for(auto pos = s.find(from); pos != std::string::npos; pos = s.find(from, pos + to.size()))
+        s.replace(pos, from.size(), to);
+}
+
+auto expand(std::string s, pie::byte uid, pie::index idx)
+{
+    replace_all(s, "{uid}", std::to_string(uid));
+    replace_all(s, "{button}", std::to_string(idx));
+    return s;
+}
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void packets::rebuild(pie::byte uid, osc_templates tmpl)
+{
+    tmpl_ = std::move(tmpl);
+    rebuild(uid);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void packets::rebuild(pie::byte uid)
+{
+    data_.clear();
+    auto prefix = "/remote/pie/" + std::to_string(uid) + "/";
+
+    auto store = [&](const osc::message& msg)
+    {
+        auto packet = msg.to_packet();
+        span s{ data_.size(), packet.size() };
+        data_.insert(data_.end(), packet.data(), packet.data() + packet.size());
+        return s;
+    };
+
+    auto add = [&](pie::index idx, const char* event, const templates& tmpls)
+    {
+        auto it = tmpls.find(idx);
+        if(it == tmpls.end())
+        {
+            osc::message msg{ prefix + std::to_string(idx) + "/" + event };
+            msg << uid << idx << event;
+            return store(msg);
+        }
+
+        auto& tmpl = it->second;
+        if(tmpl.address.empty()) return span{ };
+
+        osc::message msg{ expand(tmpl.address, uid, idx) };
+        for(auto& arg : tmpl.args) std::visit([&](auto& value)
+        {
+            using T = std::decay_t<decltype(value)>;
+            if constexpr(std::is_same_v<T, std::string>)
+                msg << expand(value, uid, idx);
+
+            else if constexpr(std::is_same_v<T, osc_template::placeholder>)
+                msg << static_cast<std::int32_t>(value == osc_template::uid ? uid : idx);
+
+            else msg << value;
+        }, arg);
+        return store(msg);
+    };
+
+    auto make = [&](const char* event)
+    {
+        osc::message msg{ prefix + event };
+        msg << uid << std::int32_t{ 0 };
+
+        auto packet = msg.to_packet();
+        return std::vector<char>(packet.data(), packet.data() + packet.size());
+    };
+    jog_ = make("jog");
+    shuttle_ = make("shuttle");
+
+    for(std::size_t n = 0; n < press_.size(); ++n)
+    {
+        auto idx = static_cast<pie::index>(n);
+        press_[n] = add(idx, "press", tmpl_.press);
+        release_[n] = add(idx, "release", tmpl_.release);
+        long_[n] = add(idx, "long-press", tmpl_.long_press);
+        repeat_[n] = add(idx, "repeat", tmpl_.repeat);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+asio::const_buffer packets::patch(std::vector<char>& packet, std::int32_t value)
+{
+    if(packet.size() < sizeof(value)) return { };
+
+    auto be = htonl(static_cast<std::uint32_t>(value));
+    std::memcpy(packet.data() + packet.size() - sizeof(be), &be, sizeof(be));
+    return asio::buffer(packet);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,92 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#ifndef SRC_PACKETS_HPP
+#define SRC_PACKETS_HPP
+
+////////////////////////////////////////////////////////////////////////////////
+#include "pie/types.hpp"
+
+#include <array>
+#include <asio.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <variant>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace src
+{
+
+////////////////////////////////////////////////////////////////////////////////
+// User-defined OSC message for a button.
+//
+// The {uid} and {button} placeholders in the address and string arguments, as
+// well as standalone placeholder arguments, are substituted when the template
+// is compiled into a packet.
+//
+struct osc_template
+{
+    enum placeholder { uid, button };
+    using arg = std::variant<std::int32_t, float, std::string, placeholder>;
+
+    std::string address; // empty = don't send anything
+    std::vector<arg> args;
+};
+
+using templates = std::map<pie::index, osc_template>;
+
+struct osc_templates
+{
+    templates press, release, long_press, repeat;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Pre-serialized OSC event packets for every button of a remote.
+//
+// All packets are stored back-to-back in one flat buffer and only need to be
+// rebuilt when the uid or the templates change.
+//
+class packets
+{
+public:
+    packets() = default;
+    explicit packets(pie::byte uid) { rebuild(uid); }
+
+    void rebuild(pie::byte uid);
+    void rebuild(pie::byte uid, osc_templates);
+
+    auto press(pie::index idx) const { return get(press_[idx]); }
+    auto release(pie::index idx) const { return get(release_[idx]); }
+    auto long_press(pie::index idx) const { return get(long_[idx]); }
+    auto repeat(pie::index idx) const { return get(repeat_[idx]); }
+
+    // jog and shuttle packets with the value patched in
+    asio::const_buffer jog(std::int32_t delta) const { return patch(jog_, delta); }
+    asio::const_buffer shuttle(std::int32_t pos) const { return patch(shuttle_, pos); }
+
+private:
+    osc_templates tmpl_;
+    std::vector<char> data_;
+
+    struct span { std::size_t offset = 0, size = 0; };
+    std::array<span, 256> press_, release_, long_, repeat_;
+
+    asio::const_buffer get(const span& s) const { return asio::buffer(data_.data() + s.offset, s.size); }
+
+    // value is the last argument of the message
+    mutable std::vector<char> jog_, shuttle_;
+    static asio::const_buffer patch(std::vector<char>&, std::int32_t);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif
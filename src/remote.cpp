@@ -6,16 +6,21 @@
 
 ////////////////////////////////////////////////////////////////////////////////
 #include "remote.hpp"
+#include "util.hpp"
 
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
 #include <functional>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <optional>
+#include <set>
 #include <sstream>
 #include <vector>
 
-using namespace std::chrono_literals;
-
 ////////////////////////////////////////////////////////////////////////////////
 namespace src
 {
@@ -24,6 +29,8 @@ namespace src
 namespace
 {
 
+constexpr std::uint16_t def_port = 6260;
+
 auto parse_word(std::stringstream& ss)
 {
     std::string word;
@@ -38,6 +45,16 @@ auto parse_num(std::stringstream& ss)
     return num;
 }
 
+bool has_num(std::stringstream& ss)
+{
+    return std::isdigit(ss.peek());
+}
+
+auto parse_msec(std::stringstream& ss)
+{
+    return std::chrono::milliseconds{ has_num(ss) ? parse_num(ss) : -1 };
+}
+
 bool parse_equal_sign(std::stringstream& ss)
 {
     char c{ };
@@ -45,22 +62,90 @@ bool parse_equal_sign(std::stringstream& ss)
     return c == '=';
 }
 
+// parse list of buttons and ranges, eg: 0 1 2 or 0,1,2 or 0-2
+auto parse_buttons(std::string spec, int buttons)
+{
+    std::vector<int> idxs;
+    for(auto& c : spec) if(c == ',') c = ' ';
+
+    std::stringstream ss{ spec };
+    ss >> std::ws;
+    while(!ss.eof())
+    {
+        auto word = parse_word(ss);
+
+        char* end;
+        auto first = std::strtol(word.data(), &end, 10);
+        auto last = first;
+        if(*end == '-') last = std::strtol(end + 1, &end, 10);
+
+        if(end == word.data() || *end || first < 0 || last >= buttons || first > last) return std::vector<int>{ };
+        for(auto idx = first; idx <= last; ++idx) idxs.push_back(idx);
+    }
+    return idxs;
+}
+
+// parse OSC address followed by a list of arguments
+std::optional<osc_template> parse_template(std::stringstream& ss)
+{
+    osc_template tmpl;
+
+    tmpl.address = parse_word(ss);
+    if(tmpl.address.empty()) return tmpl; // don't send anything
+    if(tmpl.address[0] != '/') return { };
+
+    while(!ss.eof())
+    {
+        if(ss.peek() == '"')
+        {
+            std::string value;
+            if(!(ss >> std::quoted(value) >> std::ws)) return { };
+            tmpl.args.push_back(std::move(value));
+            continue;
+        }
+
+        auto word = parse_word(ss);
+        char* end;
+
+        if(word == "{uid}") tmpl.args.push_back(osc_template::uid);
+        else if(word == "{button}") tmpl.args.push_back(osc_template::button);
+
+        else if(auto value = std::strtol(word.data(), &end, 10); !*end && value >= INT32_MIN && value <= INT32_MAX)
+            tmpl.args.push_back(static_cast<std::int32_t>(value));
+
+        else if(auto value = std::strtof(word.data(), &end); !*end)
+            tmpl.args.push_back(value);
+
+        else tmpl.args.push_back(std::move(word));
+    }
+    return tmpl;
+}
+
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-remote::remote(asio::io_context& io, fs::path path) : pie::device{ io, path },
-    path_{ std::move(path) }, timer_{ io }
+remote::remote(asio::io_context& io, fs::path path, init mode) :
+    remote{ path, std::make_unique<pie::hidraw>(io, path), mode }
+{ }
+
+////////////////////////////////////////////////////////////////////////////////
+remote::remote(fs::path path, std::unique_ptr<pie::transport> tp, init mode) : pie::device{ std::move(tp), mode },
+    path_{ std::move(path) }, packets_{ uid() }
 {
     std::cout << "Opened device " << path_ << "." << std::endl;
-    sched_check();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void remote::conf_from(const fs::path& path)
+auto remote::parse(const fs::path& path) const -> config
 {
     std::fstream fs{ path, std::ios::in };
     if(!fs.good()) throw std::invalid_argument{ "Can't open file." };
 
+    auto conf = defaults();
+    auto& layout = conf.layout;
+
+    std::set<int> group_ids;
+
     std::string read;
     for(int n = 1; std::getline(fs, read); ++n)
     {
@@ -70,20 +155,97 @@ void remote::conf_from(const fs::path& path)
         auto cmd = parse_word(ss);
         if(cmd.empty() || cmd[0] == '#') continue;
 
+        if(cmd.compare(0, 3, "osc") == 0)
+        {
+            std::string spec;
+            if(!std::getline(ss, spec, '=') || ss.eof()) throw invalid_line{ n, "Missing '=' sign" };
+            ss >> std::ws;
+
+            templates* tmpls;
+            if(cmd == "osc") tmpls = &conf.osc.press;
+            else if(cmd == "osc-release") tmpls = &conf.osc.release;
+            else if(cmd == "osc-long-press") tmpls = &conf.osc.long_press;
+            else if(cmd == "osc-repeat") tmpls = &conf.osc.repeat;
+            else throw invalid_line{ n, "Invalid command" };
+
+            auto idxs = parse_buttons(spec, buttons());
+            if(idxs.empty()) throw invalid_line{ n, "Invalid button index" };
+
+            auto tmpl = parse_template(ss);
+            if(!tmpl) throw invalid_line{ n, "Invalid OSC message" };
+
+            for(auto idx : idxs) (*tmpls)[idx] = *tmpl;
+            continue;
+        }
+
+        if(cmd == "jog-interval")
+        {
+            if(!parse_equal_sign(ss)) throw invalid_line{ n, "Missing '=' sign" };
+
+            auto interval = parse_msec(ss);
+            if(interval.count() < 0 || !ss.eof()) throw invalid_line{ n, "Invalid interval" };
+
+            layout.set_jog_interval(interval);
+            continue;
+        }
+
+        if(cmd == "destination")
+        {
+            if(!parse_equal_sign(ss)) throw invalid_line{ n, "Missing '=' sign" };
+
+            while(!ss.eof())
+            {
+                auto ep = to_endpoint(parse_word(ss), def_port);
+                if(!ep) throw invalid_line{ n, "Invalid destination" };
+
+                // OSC messages are sent over an IPv4 socket
+                if(ep->address().is_v6()) throw invalid_line{ n, "IPv6 destinations are not supported" };
+                conf.dests.push_back(*ep);
+            }
+            continue;
+        }
+
         std::function<void(int)> call;
 
         if(cmd == "double-press")
-            call = [=](int idx) { set_double_press(idx); };
+        {
+            if(has_num(ss))
+            {
+                auto timeout = parse_msec(ss);
+                if(timeout.count() <= 0) throw invalid_line{ n, "Invalid timeout" };
+
+                call = [&, timeout](int idx) { layout.set_double_press(idx, timeout); };
+            }
+            else call = [&](int idx) { layout.set_double_press(idx); };
+        }
+        else if(cmd == "long-press")
+        {
+            auto time = parse_msec(ss);
+            if(time.count() <= 0) throw invalid_line{ n, "Invalid time" };
+
+            call = [&, time](int idx) { layout.set_long_press(idx, time); };
+        }
+        else if(cmd == "repeat")
+        {
+            auto delay = parse_msec(ss);
+            auto rate = has_num(ss) ? parse_msec(ss) : delay;
+            if(delay.count() <= 0 || rate.count() <= 0) throw invalid_line{ n, "Invalid time" };
+
+            call = [&, delay, rate](int idx) { layout.set_repeat(idx, delay, rate); };
+        }
 
         else if(cmd == "toggle")
-            call = [=](int idx) { set_toggle(idx); };
+            call = [&](int idx) { layout.set_toggle(idx); };
 
         else if(cmd == "group")
         {
             auto id = parse_num(ss);
             if(id < 0) throw invalid_line{ n, "Invalid group id" };
 
-            call = [=](int idx) { set_group(idx, id); };
+            group_ids.insert(id);
+            if(group_ids.size() > pie::layout::max_groups) throw invalid_line{ n, "Too many groups" };
+
+            call = [&, id](int idx) { layout.set_group(idx, id); };
         }
         else throw invalid_line{ n, "Invalid command" };
 
@@ -96,23 +258,58 @@ void remote::conf_from(const fs::path& path)
             else throw invalid_line{ n, "Invalid button index" };
         }
     }
+
+    return conf;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void remote::sched_check()
+void remote::set_state_file(const fs::path& path, bool announce)
 {
-    timer_.expires_from_now(1000ms);
-    timer_.async_wait([&](const asio::error_code& ec)
+    state_ = std::make_unique<src::snapshot>(path);
+    if(auto snap = state_->load())
     {
-        if(ec) return;
+        restore(*snap, announce);
+        std::cout << "Restored state of device " << path_ << " from " << path << "." << std::endl;
+    }
+}
 
-        if(!fs::exists(path_))
-        {
-            std::cout << "Device " << path_ << " no longer exists." << std::endl;
-            std::raise(SIGTERM);
-        }
-        else sched_check();
-    });
+////////////////////////////////////////////////////////////////////////////////
+void remote::apply(config conf)
+{
+    set_layout(std::move(conf.layout));
+
+    conf_ = std::move(conf.dests);
+    merge_destinations();
+
+    packets_.rebuild(uid(), std::move(conf.osc));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void remote::reload(const fs::path& path)
+{
+    apply(fs::exists(path) ? parse(path) : defaults());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+auto remote::defaults() const -> config
+{
+    config conf;
+    conf.layout = pie::layout(buttons());
+    return conf;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void remote::set_destinations(src::destinations dests)
+{
+    base_ = std::move(dests);
+    merge_destinations();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void remote::merge_destinations()
+{
+    dests_ = base_;
+    dests_.insert(dests_.end(), conf_.begin(), conf_.end());
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -10,9 +10,15 @@
 
 ////////////////////////////////////////////////////////////////////////////////
 #include "pie/device.hpp"
+#include "src/journal.hpp"
+#include "src/limiter.hpp"
+#include "src/packets.hpp"
+#include "src/sender.hpp"
+#include "src/snapshot.hpp"
 
 #include <asio.hpp>
 #include <filesystem>
+#include <memory>
 #include <stdexcept>
 #include <string>
 
@@ -26,15 +32,57 @@ namespace src
 class remote : public pie::device
 {
 public:
-    remote(asio::io_context&, fs::path);
+    remote(asio::io_context&, fs::path, init = sync);
+    remote(fs::path, std::unique_ptr<pie::transport>, init = sync);
 
-    void conf_from(const fs::path&);
+    // parsed contents of a conf file
+    struct config
+    {
+        pie::layout layout;
+        src::destinations dests;
+        src::osc_templates osc;
+    };
+
+    // parse and validate conf file without touching current state
+    config parse(const fs::path&) const;
+    void apply(config);
+
+    void conf_from(const fs::path& path) { apply(parse(path)); }
+
+    // re-read conf file (or reset to defaults if it's gone)
+    void reload(const fs::path&);
+
+    const auto& path() const { return path_; }
+    const auto& packets() const { return packets_; }
+
+    // destinations from the command line, to which the ones
+    // from the conf file are added
+    void set_destinations(src::destinations);
+    const auto& destinations() const { return dests_; }
+
+    // per-button and global rate limits of press events
+    void set_limits(const src::limits& button, src::bucket* global) { limiter_ = src::limiter{ button, global }; }
+    auto& limiter() { return limiter_; }
+
+    // journal of events from this remote (nullptr if not enabled)
+    void set_journal(std::unique_ptr<src::journal> j) { journal_ = std::move(j); }
+    auto journal() { return journal_.get(); }
+
+    // keep latched state in a file and restore it from there
+    // (optionally announcing restored buttons)
+    void set_state_file(const fs::path&, bool announce);
+    void save_state() { if(state_) state_->save(latched()); }
 
 private:
     fs::path path_;
-    asio::steady_timer timer_;
+    src::packets packets_;
+    src::destinations base_, conf_, dests_;
+    src::limiter limiter_{ { }, nullptr };
+    std::unique_ptr<src::journal> journal_;
+    std::unique_ptr<src::snapshot> state_;
 
-    void sched_check();
+    void merge_destinations();
+    config defaults() const;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,90 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#include "scan.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace src
+{
+
+////////////////////////////////////////////////////////////////////////////////
+namespace
+{
+
+constexpr unsigned vendor_id = 0x05f3;
+
+// same as in 50-baker.rules
+constexpr unsigned product_ids[] =
+{
+    0x0467, 0x0469, // XK-4
+    0x046a, 0x046c, // XK-8
+    0x0426, 0x0428, // XK-12 Jog & Shuttle
+    0x0419, 0x041b, // XK-16
+    0x0403, 0x0405, // XK-24
+    0x04ff, 0x0502, // XKR-32
+    0x0461, 0x0463, // XK-60
+    0x045a, 0x045c, // XK-68 Jog & Shuttle
+    0x0441, 0x0443, // XK-80
+    0x04cb, 0x04ce, // XKE-128
+};
+
+auto read_line(const fs::path& path, const std::string& prefix = { })
+{
+    std::ifstream fs{ path };
+    for(std::string line; std::getline(fs, line); )
+        if(line.compare(0, prefix.size(), prefix) == 0) return line.substr(prefix.size());
+
+    return std::string{ };
+}
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool is_supported(const fs::path& path)
+{
+    std::error_code ec;
+    auto hid = fs::canonical("/sys/class/hidraw" / path.filename() / "device", ec);
+    if(ec) return false;
+
+    // HID_ID=<bus>:<vendor>:<product>
+    auto id = read_line(hid / "uevent", "HID_ID=");
+
+    unsigned bus, vendor, product;
+    if(std::sscanf(id.data(), "%x:%x:%x", &bus, &vendor, &product) != 3) return false;
+
+    if(vendor != vendor_id || std::find(
+        std::begin(product_ids), std::end(product_ids), product
+    ) == std::end(product_ids)) return false;
+
+    // only the 1st interface talks PI Engineering protocol
+    return read_line(hid.parent_path() / "bInterfaceNumber") == "00";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::vector<fs::path> find_devices()
+{
+    std::vector<fs::path> paths;
+
+    std::error_code ec;
+    for(auto& entry : fs::directory_iterator{ "/sys/class/hidraw", ec })
+    {
+        auto path = "/dev" / entry.path().filename();
+        if(is_supported(path)) paths.push_back(std::move(path));
+    }
+
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,32 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#ifndef SRC_SCAN_HPP
+#define SRC_SCAN_HPP
+
+////////////////////////////////////////////////////////////////////////////////
+#include <filesystem>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+////////////////////////////////////////////////////////////////////////////////
+namespace src
+{
+
+////////////////////////////////////////////////////////////////////////////////
+// check if hidraw node belongs to a supported X-Keys device
+bool is_supported(const fs::path&);
+
+// find all supported X-Keys devices
+std::vector<fs::path> find_devices();
+
+////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -0,0 +1,135 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#include "pie/latency.hpp"
+#include "pie/metrics.hpp"
+#include "sender.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include <arpa/inet.h> // htonl
+
+////////////////////////////////////////////////////////////////////////////////
+namespace src
+{
+
+////////////////////////////////////////////////////////////////////////////////
+namespace
+{
+
+constexpr std::size_t reserve = 64;
+
+// NTP time format (seconds since 1900 + fraction) in network byte order
+void to_timetag(std::chrono::system_clock::time_point tp, char* data)
+{
+    using namespace std::chrono;
+    constexpr std::uint64_t epoch = 2208988800; // 1900 -> 1970
+
+    auto ns = duration_cast<nanoseconds>(tp.time_since_epoch()).count();
+    std::uint32_t tag[] = {
+        htonl(ns / 1000000000 + epoch),
+        htonl((std::uint64_t(ns % 1000000000) << 32) / 1000000000)
+    };
+    std::memcpy(data, tag, sizeof(tag));
+}
+
+void append(std::vector<char>& v, const void* data, std::size_t n)
+{
+    auto p = static_cast<const char*>(data);
+    v.insert(v.end(), p, p + n);
+}
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+sender::sender(asio::ip::udp::socket& socket) : socket_{ socket }
+{
+    packets_.reserve(reserve);
+    bundle_.reserve(reserve * 64);
+
+    // "#bundle" + time tag (1 = immediately)
+    header_ = { '#', 'b', 'u', 'n', 'd', 'l', 'e', '\0', 0, 0, 0, 0, 0, 0, 0, 1 };
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool sender::flush(const destinations& dests, const pie::timestamp& time)
+{
+    if(packets_.empty()) return true;
+
+    bool ok;
+    if(packets_.size() == 1 && !timetag_) ok = send(packets_.front(), dests, time);
+
+    else
+    {
+        if(timetag_) to_timetag(time.real, &header_[8]);
+
+        bundle_.assign(header_.begin(), header_.end());
+        for(auto& packet : packets_)
+        {
+            std::uint32_t size = htonl(packet.size());
+            append(bundle_, &size, sizeof(size));
+            append(bundle_, packet.data(), packet.size());
+        }
+        ok = send(asio::buffer(bundle_), dests, time);
+    }
+    packets_.clear();
+
+    return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool sender::send(asio::const_buffer packet, const destinations& dests, const pie::timestamp& time)
+{
+    auto ok = true;
+
+    pie::latency().serialize.record(pie::since(time.mono));
+
+    iovec iov{ const_cast<void*>(packet.data()), packet.size() };
+
+    if(msgs_.size() < dests.size()) msgs_.resize(dests.size());
+    for(std::size_t i = 0; i < dests.size(); ++i)
+    {
+        auto& hdr = msgs_[i].msg_hdr;
+        hdr = msghdr{ };
+        hdr.msg_name = const_cast<sockaddr*>(dests[i].data());
+        hdr.msg_namelen = dests[i].size();
+        hdr.msg_iov = &iov;
+        hdr.msg_iovlen = 1;
+    }
+
+    for(std::size_t i = 0; i < dests.size(); )
+    {
+        auto n = ::sendmmsg(socket_.native_handle(), msgs_.data() + i, dests.size() - i, 0);
+        if(n < 0)
+        {
+            if(errno == EINTR) continue;
+
+            // skip failed destination and carry on with the rest
+            std::cerr << "Failed to send packet to " << dests[i] << ": " << std::strerror(errno) << std::endl;
+            ++pie::metrics().send_errors;
+            ok = false;
+            ++i;
+        }
+        else
+        {
+            pie::metrics().osc_packets += n;
+            i += n;
+        }
+    }
+
+    for(auto stream : streams_) stream->send(packet);
+
+    pie::latency().send.record(pie::since(time.mono));
+    return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}
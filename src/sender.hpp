@@ -0,0 +1,73 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#ifndef SRC_SENDER_HPP
+#define SRC_SENDER_HPP
+
+////////////////////////////////////////////////////////////////////////////////
+#include "pie/types.hpp"
+#include "src/stream.hpp"
+
+#include <array>
+#include <asio.hpp>
+#include <vector>
+
+#include <sys/socket.h> // mmsghdr
+
+////////////////////////////////////////////////////////////////////////////////
+namespace src
+{
+
+////////////////////////////////////////////////////////////////////////////////
+using destinations = std::vector<asio::ip::udp::endpoint>;
+
+////////////////////////////////////////////////////////////////////////////////
+// Collects pre-serialized OSC packets and sends them out.
+//
+// A single packet is sent as is, while multiple packets are wrapped in an OSC
+// bundle, so that the receiver applies them atomically.
+//
+// The resulting datagram is sent to all destinations with one sendmmsg call.
+//
+// In the timetag mode, packets are always sent as a bundle with the time tag
+// set to the time when the report was received.
+//
+class sender
+{
+public:
+    explicit sender(asio::ip::udp::socket&);
+
+    void timetag(bool on) { timetag_ = on; }
+
+    // also send everything to this TCP stream
+    void add_stream(stream& s) { streams_.push_back(&s); }
+
+    void add(asio::const_buffer packet) { if(packet.size()) packets_.push_back(packet); }
+
+    // return false if sending to any of the destinations failed
+    bool flush(const destinations&, const pie::timestamp&);
+
+private:
+    asio::ip::udp::socket& socket_;
+
+    std::vector<asio::const_buffer> packets_;
+    std::vector<char> bundle_;
+
+    std::array<char, 16> header_;
+    bool timetag_ = false;
+
+    std::vector<stream*> streams_;
+
+    std::vector<mmsghdr> msgs_;
+    bool send(asio::const_buffer, const destinations&, const pie::timestamp&);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif
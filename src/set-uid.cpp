@@ -55,7 +55,8 @@ try
         auto path = fs::path{ args["path"].value() };
 
         asio::io_context io;
-        pie::device device{ io, path };
+        // no need to set up LEDs or read reports
+        pie::device device{ io, path, pie::device::minimal };
 
         std::cout << "Current device uid: " << static_cast<int>(device.uid()) << std::endl;
 
@@ -0,0 +1,94 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#include "snapshot.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace src
+{
+
+////////////////////////////////////////////////////////////////////////////////
+namespace
+{
+
+constexpr char magic[8] = { 'B', 'A', 'K', 'E', 'R', 'S', 'T', 'A' };
+constexpr std::uint32_t version = 1;
+
+[[noreturn]] void throw_errno(const std::string& msg)
+{
+    throw std::system_error{ std::error_code{ errno, std::generic_category() }, msg };
+}
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+snapshot::snapshot(const fs::path& path)
+{
+    auto fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if(fd < 0) throw_errno("Can't open state file " + path.string());
+
+    struct stat st;
+    if(::fstat(fd, &st) || (static_cast<std::size_t>(st.st_size) != sizeof(data) && ::ftruncate(fd, sizeof(data))))
+    {
+        ::close(fd);
+        throw_errno("Can't resize state file " + path.string());
+    }
+
+    auto p = ::mmap(nullptr, sizeof(data), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(p == MAP_FAILED) throw_errno("Can't map state file " + path.string());
+
+    data_ = static_cast<data*>(p);
+    if(std::memcmp(data_->magic, magic, sizeof(magic)) || data_->version != version)
+    {
+        std::memset(data_, 0, sizeof(data));
+        std::memcpy(data_->magic, magic, sizeof(magic));
+        data_->version = version;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+snapshot::~snapshot() { ::munmap(data_, sizeof(data)); }
+
+////////////////////////////////////////////////////////////////////////////////
+std::optional<pie::device::snapshot> snapshot::load() const
+{
+    if(!data_->valid) return { };
+
+    pie::device::snapshot snap;
+    snap.latched = pie::index_set::from(data_->latched, sizeof(data_->latched));
+    snap.locked = data_->locked;
+
+    return snap;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void snapshot::save(const pie::device::snapshot& snap)
+{
+    pie::byte latched[sizeof(data_->latched)]{ };
+    for(auto idx : snap.latched) latched[idx / 8] |= 1 << (idx % 8);
+
+    if(data_->valid && data_->locked == snap.locked
+        && !std::memcmp(data_->latched, latched, sizeof(latched))
+    ) return;
+
+    std::memcpy(data_->latched, latched, sizeof(latched));
+    data_->locked = snap.locked;
+    data_->valid = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}
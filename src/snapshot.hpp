@@ -0,0 +1,62 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#ifndef SRC_SNAPSHOT_HPP
+#define SRC_SNAPSHOT_HPP
+
+////////////////////////////////////////////////////////////////////////////////
+#include "pie/device.hpp"
+#include "pie/types.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+
+namespace fs = std::filesystem;
+
+////////////////////////////////////////////////////////////////////////////////
+namespace src
+{
+
+////////////////////////////////////////////////////////////////////////////////
+// Latched state of a keypad kept in a small memory-mapped file.
+//
+// Saving only writes to the mapped memory when the state has changed and
+// leaves flushing to the kernel.
+//
+class snapshot
+{
+public:
+    explicit snapshot(const fs::path&);
+    ~snapshot();
+
+    snapshot(const snapshot&) = delete;
+    snapshot& operator=(const snapshot&) = delete;
+
+    // return saved state, if any
+    std::optional<pie::device::snapshot> load() const;
+    void save(const pie::device::snapshot&);
+
+    struct data
+    {
+        char magic[8];
+        std::uint32_t version;
+        pie::byte valid;
+        pie::byte locked;
+        pie::byte reserved[2];
+        pie::byte latched[32]; // 1 bit per button
+    };
+
+private:
+    data* data_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -0,0 +1,185 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#include "stream.hpp"
+#include "pie/metrics.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace src
+{
+
+////////////////////////////////////////////////////////////////////////////////
+namespace
+{
+
+using namespace std::chrono_literals;
+constexpr auto min_backoff = 100ms;
+constexpr auto max_backoff = 10s;
+
+// SLIP special characters
+constexpr char end = '\xc0', esc = '\xdb', esc_end = '\xdc', esc_esc = '\xdd';
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+stream::stream(asio::io_context& io, const asio::ip::tcp::endpoint& ep, std::size_t limit) :
+    socket_{ io }, ep_{ ep }, timer_{ io }, backoff_{ min_backoff }, limit_{ limit }
+{
+    connect();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void stream::send(asio::const_buffer packet)
+{
+    // frame packet with END on both sides, so that
+    // the receiver can resync after a lost connection
+    auto size = pending_.size();
+
+    pending_.push_back(end);
+    auto p = static_cast<const char*>(packet.data());
+    for(std::size_t n = 0; n < packet.size(); ++n)
+        switch(p[n])
+        {
+        case end: pending_.push_back(esc); pending_.push_back(esc_end); break;
+        case esc: pending_.push_back(esc); pending_.push_back(esc_esc); break;
+        default : pending_.push_back(p[n]);
+        }
+    pending_.push_back(end);
+
+    frames_.push_back(pending_.size() - size);
+
+    // drop oldest packets
+    std::size_t drop = 0;
+    while(pending_.size() - drop > limit_ && frames_.size() > 1)
+    {
+        drop += frames_.front();
+        frames_.pop_front();
+        ++dropped_;
+        ++pie::metrics().stream_dropped;
+    }
+    pending_.erase(pending_.begin(), pending_.begin() + drop);
+
+    if(drop && !warned_)
+    {
+        std::cerr << "Send queue to " << ep_ << " is full - dropping oldest packets." << std::endl;
+        warned_ = true;
+    }
+
+    // write everything sent during this loop iteration at once
+    if(connected_ && !posted_ && !busy_)
+    {
+        posted_ = true;
+        asio::post(socket_.get_executor(), [this]{ posted_ = false; sched_write(); });
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void stream::connect()
+{
+    socket_.async_connect(ep_, [this](const asio::error_code& ec)
+    {
+        if(ec == asio::error::operation_aborted) return;
+        if(ec)
+        {
+            asio::error_code ig;
+            socket_.close(ig);
+            sched_connect();
+            return;
+        }
+
+        std::cout << "Connected to " << ep_ << "." << std::endl;
+        connected_ = true;
+
+        asio::error_code e;
+        socket_.set_option(asio::ip::tcp::no_delay{ true }, e);
+        if(!e) socket_.set_option(asio::socket_base::keep_alive{ true }, e);
+        if(e)
+        {
+            disconnect(e);
+            return;
+        }
+
+        backoff_ = min_backoff;
+        warned_ = false;
+
+        sched_read();
+        sched_write();
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void stream::disconnect(const asio::error_code& ec)
+{
+    if(!connected_) return;
+
+    std::cerr << "Lost connection to " << ep_ << ": " << ec.message() << std::endl;
+    connected_ = false;
+
+    asio::error_code ig;
+    socket_.close(ig);
+
+    sched_connect();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void stream::sched_connect()
+{
+    timer_.expires_after(backoff_);
+    timer_.async_wait([this](const asio::error_code& ec){ if(!ec) connect(); });
+
+    backoff_ = std::min<std::chrono::milliseconds>(backoff_ * 2, max_backoff);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void stream::sched_read()
+{
+    // nothing is expected from the other side;
+    // read to find out when the connection is closed
+    socket_.async_read_some(asio::buffer(data_), [this](const asio::error_code& ec, std::size_t)
+    {
+        if(ec == asio::error::operation_aborted) return;
+        if(ec) disconnect(ec);
+        else sched_read();
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void stream::sched_write()
+{
+    if(busy_ || !connected_ || pending_.empty()) return;
+
+    busy_ = true;
+    writing_.swap(pending_);
+    wframes_.swap(frames_);
+
+    asio::async_write(socket_, asio::buffer(writing_), [this](const asio::error_code& ec, std::size_t)
+    {
+        busy_ = false;
+        if(ec)
+        {
+            // put unsent packets back in front; the receiver may
+            // get some of them twice, but won't miss any
+            writing_.insert(writing_.end(), pending_.begin(), pending_.end());
+            pending_.swap(writing_);
+
+            wframes_.insert(wframes_.end(), frames_.begin(), frames_.end());
+            frames_.swap(wframes_);
+
+            if(ec != asio::error::operation_aborted) disconnect(ec);
+        }
+        writing_.clear();
+        wframes_.clear();
+
+        sched_write();
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,68 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#ifndef SRC_STREAM_HPP
+#define SRC_STREAM_HPP
+
+////////////////////////////////////////////////////////////////////////////////
+#include <asio.hpp>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace src
+{
+
+////////////////////////////////////////////////////////////////////////////////
+// Sends OSC packets over TCP with SLIP framing (OSC 1.1).
+//
+// Keeps a persistent connection and reconnects with exponential backoff when
+// it's lost. Packets sent during the same loop iteration are combined into one
+// write. While disconnected, packets are queued up to the given limit, after
+// which the oldest ones are dropped.
+//
+class stream
+{
+public:
+    stream(asio::io_context&, const asio::ip::tcp::endpoint&, std::size_t limit = 1024 * 1024);
+
+    void send(asio::const_buffer packet);
+
+    const auto& endpoint() const { return ep_; }
+    auto dropped() const { return dropped_; }
+
+private:
+    asio::ip::tcp::socket socket_;
+    asio::ip::tcp::endpoint ep_;
+
+    bool connected_ = false;
+    void connect();
+    void disconnect(const asio::error_code&);
+
+    asio::steady_timer timer_;
+    std::chrono::milliseconds backoff_;
+    void sched_connect();
+
+    char data_[256];
+    void sched_read();
+
+    std::size_t limit_, dropped_ = 0;
+    bool warned_ = false; // about dropped packets during this outage
+    std::vector<char> pending_, writing_;
+    std::deque<std::size_t> frames_, wframes_; // size of each frame
+
+    bool posted_ = false, busy_ = false;
+    void sched_write();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif
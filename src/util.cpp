@@ -6,7 +6,9 @@
 
 ////////////////////////////////////////////////////////////////////////////////
 #include "util.hpp"
+#include <algorithm>
 #include <csignal>
+#include <cstdlib>
 
 ////////////////////////////////////////////////////////////////////////////////
 namespace src
@@ -32,5 +34,42 @@ void on_interrupt(interrupt_callback cb)
     }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+std::optional<asio::ip::udp::endpoint> to_endpoint(const std::string& s, std::uint16_t def_port)
+{
+    std::string addr = s, port;
+
+    if(s.size() && s[0] == '[')
+    {
+        auto p = s.find(']');
+        if(p == std::string::npos) return { };
+
+        addr = s.substr(1, p - 1);
+        if(p + 1 < s.size())
+        {
+            if(s[p + 1] != ':') return { };
+            port = s.substr(p + 2);
+        }
+    }
+    else if(std::count(s.begin(), s.end(), ':') == 1)
+    {
+        auto p = s.find(':');
+        addr = s.substr(0, p);
+        port = s.substr(p + 1);
+    }
+
+    asio::error_code ec;
+    auto address = asio::ip::make_address(addr, ec);
+    if(ec) return { };
+
+    if(port.empty()) return asio::ip::udp::endpoint{ address, def_port };
+
+    char* end;
+    auto ul = std::strtoul(port.data(), &end, 0);
+    if(ul > UINT16_MAX || end != (port.data() + port.size())) return { };
+
+    return asio::ip::udp::endpoint{ address, static_cast<std::uint16_t>(ul) };
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 }
@@ -9,7 +9,11 @@
 #define SRC_UTIL_HPP
 
 ////////////////////////////////////////////////////////////////////////////////
+#include <asio.hpp>
+#include <cstdint>
 #include <functional>
+#include <optional>
+#include <string>
 
 ////////////////////////////////////////////////////////////////////////////////
 namespace src
@@ -19,6 +23,9 @@ namespace src
 using interrupt_callback = std::function<void (int)>;
 void on_interrupt(interrupt_callback);
 
+// parse endpoint in the form <addr>[:<port>] or [<addr6>][:<port>]
+std::optional<asio::ip::udp::endpoint> to_endpoint(const std::string&, std::uint16_t def_port);
+
 ////////////////////////////////////////////////////////////////////////////////
 }
 
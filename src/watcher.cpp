@@ -0,0 +1,58 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#include "watcher.hpp"
+
+#include <cerrno>
+#include <system_error>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace src
+{
+
+////////////////////////////////////////////////////////////////////////////////
+watcher::watcher(asio::io_context& io, const fs::path& dir, std::uint32_t mask, watch_callback cb) :
+    fd_{ io }, cb_{ std::move(cb) }
+{
+    auto fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(fd == -1) throw std::system_error{
+        std::error_code{ errno, std::generic_category() }
+    };
+    fd_.assign(fd);
+
+    if(::inotify_add_watch(fd, dir.c_str(), mask) == -1) throw std::system_error{
+        std::error_code{ errno, std::generic_category() }, dir.string()
+    };
+
+    sched_read();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void watcher::sched_read()
+{
+    using namespace std::placeholders;
+    fd_.async_read_some(asio::buffer(data_), std::bind(&watcher::read_data, this, _1, _2));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void watcher::read_data(const asio::error_code& ec, std::size_t n)
+{
+    if(ec) return;
+
+    for(std::size_t i = 0; i + sizeof(inotify_event) <= n; )
+    {
+        auto event = reinterpret_cast<const inotify_event*>(data_ + i);
+        if(event->len && cb_) cb_(event->name, event->mask);
+
+        i += sizeof(inotify_event) + event->len;
+    }
+
+    sched_read();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,53 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#ifndef SRC_WATCHER_HPP
+#define SRC_WATCHER_HPP
+
+////////////////////////////////////////////////////////////////////////////////
+#include <asio.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+
+#include <sys/inotify.h>
+
+namespace fs = std::filesystem;
+
+////////////////////////////////////////////////////////////////////////////////
+namespace src
+{
+
+////////////////////////////////////////////////////////////////////////////////
+using watch_callback = std::function<void (const std::string& name, std::uint32_t mask)>;
+
+////////////////////////////////////////////////////////////////////////////////
+// Watches directory for changes using inotify.
+//
+// Events are delivered on the io_context with the name of the affected file
+// and the inotify event mask (IN_CREATE, IN_DELETE, etc).
+//
+class watcher
+{
+public:
+    watcher(asio::io_context&, const fs::path& dir, std::uint32_t mask, watch_callback);
+
+private:
+    asio::posix::stream_descriptor fd_;
+    watch_callback cb_;
+
+    alignas(inotify_event) char data_[4096];
+    void sched_read();
+    void read_data(const asio::error_code&, std::size_t n);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#endif
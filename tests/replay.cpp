@@ -0,0 +1,113 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Dimitry Ishenko
+// Contact: dimitry (dot) ishenko (at) (gee) mail (dot) com
+//
+// Distributed under the GNU GPL license. See the LICENSE.md file for details.
+
+////////////////////////////////////////////////////////////////////////////////
+#include "pie/device.hpp"
+#include "pie/record.hpp"
+#include "pie/types.hpp"
+
+#include <asio.hpp>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+////////////////////////////////////////////////////////////////////////////////
+namespace
+{
+
+constexpr pie::byte columns = 16, rows = 8; // XKE-128
+constexpr pie::byte descriptor_cmd = 214;
+
+void add(std::ofstream& fs, std::uint64_t time, const pie::recv& data)
+{
+    pie::rec::header hdr{ time, pie::rec::in, static_cast<pie::byte>(data.size()) };
+    fs.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    fs.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+pie::recv descriptor()
+{
+    pie::recv data{ };
+    auto dd = data.as<pie::descriptor_data>();
+    dd->cmd = descriptor_cmd;
+    dd->columns = columns;
+    dd->rows = rows;
+    return data;
+}
+
+pie::recv buttons(std::initializer_list<pie::index> pressed)
+{
+    pie::recv data{ };
+    auto gd = data.as<pie::general_data>();
+    for(auto idx : pressed) gd->buttons[idx / 8] |= 1 << (idx % 8);
+    return data;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Replay descriptor reply followed by a late duplicate (eg, reply to a
+// resent request) and make sure the latter doesn't register as presses.
+//
+bool late_descriptor(const fs::path& path)
+{
+    {
+        std::ofstream fs{ path, std::ios::binary };
+        fs.write(pie::rec::magic, sizeof(pie::rec::magic));
+
+        add(fs, 0, descriptor());
+        add(fs, 1000, descriptor());
+        add(fs, 2000, buttons({ 3 }));
+        add(fs, 3000, buttons({ }));
+    }
+
+    asio::io_context io;
+    pie::device device{ std::make_unique<pie::replayer>(io, path, pie::replayer::max), pie::device::async };
+
+    asio::error_code init;
+    device.on_ready([&](const asio::error_code& ec){ init = ec; });
+
+    std::vector<pie::index> presses, releases;
+    device.on_press([&](const pie::event& ev){ presses.push_back(ev.idx); });
+    device.on_release([&](const pie::event& ev){ releases.push_back(ev.idx); });
+
+    io.run();
+    fs::remove(path);
+
+    if(init || !device.ready())
+    {
+        std::cerr << "late_descriptor: init failed: " << init.message() << std::endl;
+        return false;
+    }
+    if(presses != std::vector<pie::index>{ 3 } || releases != std::vector<pie::index>{ 3 })
+    {
+        std::cerr << "late_descriptor: got " << presses.size() << " presses and " << releases.size() << " releases" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main()
+try
+{
+    bool pass = true;
+    pass &= late_descriptor(fs::temp_directory_path() / "baker-late-descriptor.rec");
+
+    return pass ? 0 : 1;
+}
+catch(const std::exception& e)
+{
+    std::cerr << e.what() << std::endl;
+    return 1;
+}